@@ -0,0 +1,238 @@
+/**
+ * QML examples - Qt5 and QML examples
+ * Copyright (c) 2019 Yuri Young<yuri.young@qq.com>
+ *
+ * This examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "benchmark.h"
+#include "migration.h"
+#include "statementcache.h"
+
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QTemporaryDir>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QUuid>
+#include <QLoggingCategory>
+
+Q_LOGGING_CATEGORY(lcBenchmark, "app.Benchmark")
+
+// rows read by one select
+static const int pageSize = 100;
+
+static qreal rate(int count, qint64 nsecs)
+{
+    return nsecs > 0 ? count * 1e9 / nsecs : 0;
+}
+
+Benchmark::Benchmark(const QStringList &migrations)
+    : m_migrations(migrations)
+{
+}
+
+void Benchmark::setRows(int rows)
+{
+    m_rows = qMax(1, rows);
+}
+
+int Benchmark::rows() const
+{
+    return m_rows;
+}
+
+void Benchmark::setOperations(int count)
+{
+    m_operations = qMax(1, count);
+}
+
+int Benchmark::operations() const
+{
+    return m_operations;
+}
+
+/**
+ * @brief migrations whose failure does not fail the benchmark, see Migration::setOptional()
+ * @param migrations
+ */
+void Benchmark::setOptional(const QStringList &migrations)
+{
+    m_optional = migrations;
+}
+
+QStringList Benchmark::optional() const
+{
+    return m_optional;
+}
+
+/**
+ * @brief measure one profile, the InMemory profile runs on a memory
+ * database, the others on a file in the directory
+ * @param profile
+ * @param directory
+ * @return
+ */
+Benchmark::Result Benchmark::run(StorageProfile::Profile profile, const QString &directory)
+{
+    Result result;
+    result.profile = profile;
+    result.rows = m_rows;
+    result.databaseName = profile == StorageProfile::InMemory
+            ? QString(":memory:")
+            : QString("%1/%2.db").arg(directory, StorageProfile::name(profile));
+
+    const QString connectionName = QUuid::createUuid().toString(QUuid::Id128);
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+        db.setDatabaseName(result.databaseName);
+        if(!db.open())
+        {
+            result.error = db.lastError().text();
+        }
+        else
+        {
+            StorageProfile::apply(db, profile);
+            QRandomGenerator random(1);
+            QElapsedTimer clock;
+
+            Migration migration(db);
+            migration.setSingleTransaction(true);
+            migration.setOptional(m_optional);
+            if(!migration.run(m_migrations))
+                result.error = "Migration failed";
+
+            // inserts, one transaction
+            if(result.error.isEmpty())
+            {
+                QSqlQuery insert(db);
+                insert.prepare("INSERT INTO books (title, isdn, author, publisher, time, page, price, description, rating) "
+                               "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)");
+                clock.start();
+                db.transaction();
+                for (int i = 0; i < m_rows && result.error.isEmpty(); ++i)
+                {
+                    insert.addBindValue(QString("Book %1").arg(i));
+                    insert.addBindValue(QString::number(9787000000000LL + i));
+                    insert.addBindValue(QString("Author %1").arg(i % 997));
+                    insert.addBindValue(QString("Publisher %1").arg(i % 31));
+                    insert.addBindValue(QString("20%1-%2-1").arg(10 + i % 10).arg(1 + i % 12));
+                    insert.addBindValue(100 + i % 900);
+                    insert.addBindValue(1000 + random.bounded(9000));
+                    insert.addBindValue(QString("Description of book %1").arg(i));
+                    insert.addBindValue(1 + i % 5);
+                    if(!insert.exec())
+                        result.error = insert.lastError().text();
+                }
+                if(result.error.isEmpty())
+                    db.commit();
+                else
+                    db.rollback();
+                result.inserts = rate(m_rows, clock.nsecsElapsed());
+            }
+
+            // keyset pages from random keys
+            if(result.error.isEmpty())
+            {
+                QSqlQuery select(db);
+                select.setForwardOnly(true);
+                select.prepare("SELECT id, title, author, price FROM books WHERE id > ? ORDER BY id LIMIT ?");
+                clock.start();
+                for (int i = 0; i < m_operations && result.error.isEmpty(); ++i)
+                {
+                    select.addBindValue(random.bounded(m_rows));
+                    select.addBindValue(pageSize);
+                    if(!select.exec())
+                        result.error = select.lastError().text();
+                    while (select.next())
+                        select.value(1);
+                    select.finish();
+                }
+                result.selects = rate(m_operations, clock.nsecsElapsed());
+            }
+
+            // updates, one transaction each
+            if(result.error.isEmpty())
+            {
+                QSqlQuery update(db);
+                update.prepare("UPDATE books SET price = ? WHERE id = ?");
+                clock.start();
+                for (int i = 0; i < m_operations && result.error.isEmpty(); ++i)
+                {
+                    update.addBindValue(1000 + random.bounded(9000));
+                    update.addBindValue(1 + random.bounded(m_rows));
+                    if(!update.exec())
+                        result.error = update.lastError().text();
+                }
+                result.updates = rate(m_operations, clock.nsecsElapsed());
+            }
+        }
+
+        StatementCache::local()->invalidate(db);
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(connectionName);
+
+    if(!result.error.isEmpty())
+        qWarning(lcBenchmark) << StorageProfile::name(profile) << result.error;
+
+    return result;
+}
+
+QVector<Benchmark::Result> Benchmark::runAll()
+{
+    QVector<Result> results;
+    QTemporaryDir directory;
+    if(!directory.isValid())
+    {
+        qWarning(lcBenchmark) << "Can not create a temporary directory";
+        return results;
+    }
+
+    for (StorageProfile::Profile profile : StorageProfile::profiles())
+        results << run(profile, directory.path());
+
+    return results;
+}
+
+QString Benchmark::report(const QVector<Result> &results)
+{
+    QString text = QString("%1 %2 %3 %4\n")
+            .arg("profile", -12)
+            .arg("inserts/s", 12)
+            .arg("selects/s", 12)
+            .arg("updates/s", 12);
+
+    for (const Result &result : results)
+    {
+        if(!result.error.isEmpty())
+        {
+            text += QString("%1 failed: %2\n").arg(StorageProfile::name(result.profile), -12).arg(result.error);
+            continue;
+        }
+
+        text += QString("%1 %2 %3 %4\n")
+                .arg(StorageProfile::name(result.profile), -12)
+                .arg(result.inserts, 12, 'f', 0)
+                .arg(result.selects, 12, 'f', 0)
+                .arg(result.updates, 12, 'f', 0);
+    }
+
+    if(!results.isEmpty())
+        text += QString("%1 rows, selects read %2 rows, updates commit one row\n")
+                .arg(results.first().rows).arg(pageSize);
+
+    return text;
+}
@@ -0,0 +1,70 @@
+/**
+ * QML examples - Qt5 and QML examples
+ * Copyright (c) 2019 Yuri Young<yuri.young@qq.com>
+ *
+ * This examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <QStringList>
+#include <QVector>
+
+#include "storageprofile.h"
+
+/**
+ * @brief measures the storage profiles on a generated books table.
+ * each profile gets a database of its own, created by the migrations of
+ * the application, then rows are inserted in one transaction, read back a
+ * page at a time and updated one row per transaction.
+ */
+class Benchmark
+{
+public:
+    struct Result
+    {
+        StorageProfile::Profile profile = StorageProfile::Default;
+        QString databaseName;
+        int rows = 0;
+        qreal inserts = 0;      // rows per second
+        qreal selects = 0;      // pages per second
+        qreal updates = 0;      // transactions per second
+        QString error;
+    };
+
+    explicit Benchmark(const QStringList &migrations);
+
+    void setRows(int rows);
+    int rows() const;
+
+    void setOperations(int count);
+    int operations() const;
+
+    void setOptional(const QStringList &migrations);
+    QStringList optional() const;
+
+    Result run(StorageProfile::Profile profile, const QString &directory);
+    QVector<Result> runAll();
+
+    static QString report(const QVector<Result> &results);
+
+private:
+    QStringList m_migrations;
+    QStringList m_optional;
+    int m_rows = 100000;
+    int m_operations = 2000;
+};
+
+#endif // BENCHMARK_H
@@ -0,0 +1,537 @@
+/**
+ * QML examples - Qt5 and QML examples
+ * Copyright (c) 2019 Yuri Young<yuri.young@qq.com>
+ *
+ * This examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "connectionpool.h"
+#include "statementcache.h"
+
+#include <QThread>
+#include <QElapsedTimer>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QUuid>
+#include <QVector>
+#include <QLoggingCategory>
+
+#include <limits>
+
+Q_LOGGING_CATEGORY(lcConnectionPool, "app.ConnectionPool")
+
+static const QString DRIVER = "QSQLITE";
+
+static unsigned long remaining(const QElapsedTimer &clock, int timeout)
+{
+    if(timeout < 0)
+        return std::numeric_limits<unsigned long>::max();
+    return (unsigned long)qMax<qint64>(0, timeout - clock.elapsed());
+}
+
+/**
+ * @brief the connections opened by one thread, closed with the thread
+ */
+struct ConnectionPool::ThreadConnections
+{
+    struct Connection
+    {
+        QString name;
+        QString databaseName;
+        ConnectionPool::Mode mode = ConnectionPool::ReadMode;
+        bool busy = false;
+        int depth = 0;          // checkouts of a write connection held by its thread
+        bool expired = false;   // idle too long, closed by its thread
+        QElapsedTimer idle;
+    };
+
+    explicit ThreadConnections(ConnectionPool *pool) : pool(pool) {}
+    ~ThreadConnections();
+
+    ConnectionPool *pool;
+    QString threadConnection;
+    QVector<Connection> connections;
+    StatementCache statements;
+};
+
+ConnectionPool::ThreadConnections::~ThreadConnections()
+{
+    {
+        QMutexLocker locker(&pool->m_mutex);
+        pool->m_registry.removeOne(this);
+    }
+
+    // statements go first, they hold on to their connections
+    statements.clear();
+    for (int i = connections.count() - 1; i >= 0; --i)
+        pool->close(this, i);
+
+    if(!threadConnection.isEmpty())
+    {
+        {
+            QSqlDatabase db = QSqlDatabase::database(threadConnection, false);
+            db.close();
+        }
+        QSqlDatabase::removeDatabase(threadConnection);
+    }
+}
+
+ConnectionPool::ConnectionPool()
+{
+}
+
+ConnectionPool *ConnectionPool::instance()
+{
+    static ConnectionPool pool;
+    return &pool;
+}
+
+void ConnectionPool::setMaxConnections(int count)
+{
+    QMutexLocker locker(&m_mutex);
+    m_maxConnections = qMax(1, count);
+    m_available.wakeAll();
+}
+
+int ConnectionPool::maxConnections() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_maxConnections;
+}
+
+void ConnectionPool::setIdleTimeout(int msecs)
+{
+    QMutexLocker locker(&m_mutex);
+    m_idleTimeout = qMax(0, msecs);
+}
+
+int ConnectionPool::idleTimeout() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_idleTimeout;
+}
+
+/**
+ * @brief the storage profile for connections opened to the database
+ * from now on, open connections keep theirs
+ * @param databaseName
+ * @param profile
+ */
+void ConnectionPool::setStorageProfile(const QString &databaseName, StorageProfile::Profile profile)
+{
+    QMutexLocker locker(&m_mutex);
+    m_profiles.insert(databaseName, profile);
+}
+
+StorageProfile::Profile ConnectionPool::storageProfile(const QString &databaseName) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_profiles.value(databaseName, StorageProfile::Default);
+}
+
+/**
+ * @brief the long lived connection of the calling thread, used by models
+ * which read and write on the thread they live in. it does not count
+ * against maxConnections and is closed when the thread finishes.
+ * it is not query only: writes on it hold the writer lock of the database,
+ * see lockWriter(), so they do not race the write connections.
+ * @param databaseName only applied when the connection is created
+ * @param open
+ * @return
+ */
+QSqlDatabase ConnectionPool::threadConnection(const QString &databaseName, bool open)
+{
+    ThreadConnections *thread = local();
+    if(!thread->threadConnection.isEmpty())
+        return QSqlDatabase::database(thread->threadConnection, false);
+
+    thread->threadConnection = QUuid::createUuid().toString(QUuid::Id128);
+    QSqlDatabase db = QSqlDatabase::addDatabase(DRIVER, thread->threadConnection);
+    if(!databaseName.isEmpty())
+        db.setDatabaseName(databaseName);
+
+    if(open && db.open())
+        configure(db, WriteMode);
+
+    return db;
+}
+
+/**
+ * @brief a connection of the calling thread to the database, to be given
+ * back with checkin() on the same thread
+ * @param databaseName
+ * @param mode one write connection is checked out at a time,
+ * a thread that holds it and checks it out again gets the same connection
+ * @param timeout milliseconds to wait for a free connection, -1 waits forever
+ * @return an invalid connection on timeout, a closed one if it can not open
+ */
+QSqlDatabase ConnectionPool::checkout(const QString &databaseName, Mode mode, int timeout)
+{
+    ThreadConnections *thread = local();
+    QElapsedTimer clock;
+    clock.start();
+
+    int index = -1;
+    bool waited = false;
+    {
+        QMutexLocker locker(&m_mutex);
+        ++m_metrics.checkouts;
+        if(mode == WriteMode)
+        {
+            if(!acquireWriter(databaseName, clock, timeout, &waited))
+                return QSqlDatabase();
+
+            // a second write connection of the thread would wait for the first
+            for (ThreadConnections::Connection &connection : thread->connections)
+            {
+                if(connection.busy && connection.mode == WriteMode && connection.databaseName == databaseName)
+                {
+                    ++connection.depth;
+                    return QSqlDatabase::database(connection.name, false);
+                }
+            }
+        }
+
+        for (int i = 0; i < thread->connections.count(); ++i)
+        {
+            const ThreadConnections::Connection &connection = thread->connections.at(i);
+            if(!connection.busy && !connection.expired && connection.mode == mode
+                    && connection.databaseName == databaseName)
+            {
+                index = i;
+                break;
+            }
+        }
+
+        while (m_metrics.busy >= m_maxConnections)
+        {
+            waited = true;
+            if(!m_available.wait(&m_mutex, remaining(clock, timeout)))
+            {
+                ++m_metrics.timeouts;
+                locker.unlock();
+                if(mode == WriteMode)
+                    releaseWriter(databaseName);
+                return QSqlDatabase();
+            }
+        }
+
+        ++m_metrics.busy;
+        if(waited)
+        {
+            const qint64 elapsed = clock.elapsed();
+            ++m_metrics.waits;
+            m_metrics.waitTime += elapsed;
+            m_metrics.maxWaitTime = qMax(m_metrics.maxWaitTime, elapsed);
+        }
+    }
+
+    if(index == -1)
+    {
+        ThreadConnections::Connection connection;
+        connection.name = QUuid::createUuid().toString(QUuid::Id128);
+        connection.databaseName = databaseName;
+        connection.mode = mode;
+
+        QSqlDatabase db = QSqlDatabase::addDatabase(DRIVER, connection.name);
+        db.setDatabaseName(databaseName);
+        if(db.open())
+            configure(db, mode);
+        else
+            qWarning(lcConnectionPool) << "Can not open database" << databaseName << db.lastError().text();
+
+        // reap() of other threads reads the connections under the mutex
+        QMutexLocker locker(&m_mutex);
+        thread->connections.append(connection);
+        index = thread->connections.count() - 1;
+        ++m_metrics.created;
+        ++m_metrics.connections;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    ThreadConnections::Connection &connection = thread->connections[index];
+    connection.busy = true;
+    connection.depth = 1;
+    return QSqlDatabase::database(connection.name, false);
+}
+
+/**
+ * @brief give a connection back, it stays open for the next checkout
+ * of the thread until it is idle for longer than idleTimeout
+ * @param db
+ */
+void ConnectionPool::checkin(const QSqlDatabase &db)
+{
+    ThreadConnections *thread = local();
+    const QString name = db.connectionName();
+    for (ThreadConnections::Connection &connection : thread->connections)
+    {
+        if(connection.name != name || !connection.busy)
+            continue;
+
+        {
+            QMutexLocker locker(&m_mutex);
+            // a nested checkout of the write connection gives back its own
+            if(--connection.depth <= 0)
+            {
+                connection.busy = false;
+                connection.depth = 0;
+                connection.idle.start();
+                --m_metrics.busy;
+                m_available.wakeOne();
+            }
+        }
+
+        if(connection.mode == WriteMode)
+            releaseWriter(connection.databaseName);
+        break;
+    }
+
+    reap();
+}
+
+/**
+ * @brief open a connection, e.g. the thread connection after its database
+ * name changed, and configure it like the connections of the pool:
+ * busy_timeout, the storage profile of the database and query_only
+ * @param db
+ * @param mode
+ * @return false if it can not open
+ */
+bool ConnectionPool::open(QSqlDatabase &db, Mode mode)
+{
+    if(!db.open())
+    {
+        qWarning(lcConnectionPool) << "Can not open database" << db.databaseName() << db.lastError().text();
+        return false;
+    }
+
+    configure(db, mode);
+    return true;
+}
+
+/**
+ * @brief take the writer lock of the database without a connection, for
+ * writes on the thread connection. the lock is reentrant for the thread
+ * holding it, also across checkout(WriteMode).
+ * @param databaseName
+ * @param timeout milliseconds to wait for the writer, -1 waits forever
+ * @return false on timeout
+ */
+bool ConnectionPool::lockWriter(const QString &databaseName, int timeout)
+{
+    QElapsedTimer clock;
+    clock.start();
+    bool waited = false;
+
+    QMutexLocker locker(&m_mutex);
+    const bool locked = acquireWriter(databaseName, clock, timeout, &waited);
+    if(waited)
+    {
+        const qint64 elapsed = clock.elapsed();
+        ++m_metrics.waits;
+        m_metrics.waitTime += elapsed;
+        m_metrics.maxWaitTime = qMax(m_metrics.maxWaitTime, elapsed);
+    }
+    return locked;
+}
+
+void ConnectionPool::unlockWriter(const QString &databaseName)
+{
+    releaseWriter(databaseName);
+}
+
+/**
+ * @brief close the connections idle for too long, of all threads.
+ * a connection can only be closed by the thread that opened it: the idle
+ * connections of every thread are marked under the mutex, the calling
+ * thread closes its own, the others close theirs on their next checkin,
+ * or when they finish.
+ */
+void ConnectionPool::reap()
+{
+    ThreadConnections *thread = local();
+    QVector<int> expired;
+    {
+        QMutexLocker locker(&m_mutex);
+        for (ThreadConnections *other : qAsConst(m_registry))
+        {
+            for (ThreadConnections::Connection &connection : other->connections)
+            {
+                if(!connection.busy && connection.idle.isValid() && connection.idle.hasExpired(m_idleTimeout))
+                    connection.expired = true;
+            }
+        }
+
+        for (int i = thread->connections.count() - 1; i >= 0; --i)
+        {
+            const ThreadConnections::Connection &connection = thread->connections.at(i);
+            if(connection.expired && !connection.busy)
+                expired << i;
+        }
+    }
+
+    // from the last, the indexes before stay valid
+    for (int index : qAsConst(expired))
+    {
+        close(thread, index);
+        QMutexLocker locker(&m_mutex);
+        ++m_metrics.reaped;
+    }
+}
+
+/**
+ * @brief the statement cache of the calling thread,
+ * see StatementCache::local()
+ * @return
+ */
+StatementCache *ConnectionPool::statements()
+{
+    return &local()->statements;
+}
+
+ConnectionPool::Metrics ConnectionPool::metrics() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_metrics;
+}
+
+ConnectionPool::ThreadConnections *ConnectionPool::local()
+{
+    if(!m_threads.hasLocalData())
+    {
+        ThreadConnections *thread = new ThreadConnections(this);
+        m_threads.setLocalData(thread);
+        QMutexLocker locker(&m_mutex);
+        m_registry.append(thread);
+    }
+    return m_threads.localData();
+}
+
+/**
+ * @brief apply the storage profile of the database, WAL in the default
+ * profile lets readers go on while a writer commits. readers are made
+ * query only.
+ * @param db
+ * @param mode
+ */
+void ConnectionPool::configure(QSqlDatabase &db, Mode mode)
+{
+    QSqlQuery query(db);
+    query.exec("PRAGMA busy_timeout = 5000");
+    StorageProfile::apply(db, storageProfile(db.databaseName()));
+    if(mode == ReadMode)
+        query.exec("PRAGMA query_only = 1");
+}
+
+void ConnectionPool::close(ThreadConnections *thread, int index)
+{
+    ThreadConnections::Connection connection;
+    {
+        QMutexLocker locker(&m_mutex);
+        connection = thread->connections.takeAt(index);
+    }
+    {
+        QSqlDatabase db = QSqlDatabase::database(connection.name, false);
+        thread->statements.invalidate(db);
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(connection.name);
+
+    QMutexLocker locker(&m_mutex);
+    --m_metrics.connections;
+    if(connection.busy)
+    {
+        --m_metrics.busy;
+        m_available.wakeOne();
+    }
+}
+
+/**
+ * @brief wait until no other thread writes to the database, called with
+ * the mutex held
+ * @return false on timeout
+ */
+bool ConnectionPool::acquireWriter(const QString &databaseName, const QElapsedTimer &clock,
+                                   int timeout, bool *waited)
+{
+    const Qt::HANDLE self = QThread::currentThreadId();
+    for (;;)
+    {
+        // looked up again after each wait, other databases may have been added
+        Writer &writer = m_writers[databaseName];
+        if(!writer.thread || writer.thread == self)
+        {
+            writer.thread = self;
+            ++writer.depth;
+            return true;
+        }
+
+        *waited = true;
+        if(!m_writerFree.wait(&m_mutex, remaining(clock, timeout)))
+        {
+            ++m_metrics.timeouts;
+            return false;
+        }
+    }
+}
+
+void ConnectionPool::releaseWriter(const QString &databaseName)
+{
+    QMutexLocker locker(&m_mutex);
+    auto it = m_writers.find(databaseName);
+    if(it == m_writers.end() || it->thread != QThread::currentThreadId() || --it->depth > 0)
+        return;
+
+    m_writers.erase(it);
+    m_writerFree.wakeAll();
+}
+
+PooledConnection::PooledConnection(const QString &databaseName, ConnectionPool::Mode mode, int timeout)
+    : m_database(ConnectionPool::instance()->checkout(databaseName, mode, timeout))
+{
+}
+
+PooledConnection::~PooledConnection()
+{
+    if(m_database.isValid())
+        ConnectionPool::instance()->checkin(m_database);
+}
+
+QSqlDatabase PooledConnection::database() const
+{
+    return m_database;
+}
+
+bool PooledConnection::isOpen() const
+{
+    return m_database.isOpen();
+}
+
+WriterLock::WriterLock(const QString &databaseName, int timeout)
+    : m_databaseName(databaseName),
+      m_locked(ConnectionPool::instance()->lockWriter(databaseName, timeout))
+{
+}
+
+WriterLock::~WriterLock()
+{
+    if(m_locked)
+        ConnectionPool::instance()->unlockWriter(m_databaseName);
+}
+
+bool WriterLock::isLocked() const
+{
+    return m_locked;
+}
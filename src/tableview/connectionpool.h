@@ -0,0 +1,160 @@
+/**
+ * QML examples - Qt5 and QML examples
+ * Copyright (c) 2019 Yuri Young<yuri.young@qq.com>
+ *
+ * This examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CONNECTIONPOOL_H
+#define CONNECTIONPOOL_H
+
+#include <QMutex>
+#include <QWaitCondition>
+#include <QThreadStorage>
+#include <QSqlDatabase>
+#include <QHash>
+#include <QVector>
+#include <QElapsedTimer>
+
+#include "storageprofile.h"
+
+class StatementCache;
+
+/**
+ * @brief a bounded pool of sqlite connections.
+ * a Qt connection can only be used by the thread that opened it, so the
+ * pool reuses idle connections within a thread and bounds the connections
+ * in use across threads: checkout() waits while maxConnections are in use.
+ * write connections of a database are handed out one at a time, reader
+ * connections are query only and read in parallel with the writer in WAL
+ * mode. writes on the thread connection take the same writer lock with
+ * lockWriter(), see WriterLock.
+ * idle connections of all threads are closed after idleTimeout, each by
+ * its own thread, and all connections of a thread are closed when the
+ * thread finishes. connections are configured
+ * with the storage profile of their database when they open.
+ */
+class ConnectionPool
+{
+    Q_DISABLE_COPY(ConnectionPool)
+public:
+    enum Mode {
+        ReadMode = 0,
+        WriteMode
+    };
+
+    struct Metrics
+    {
+        int connections = 0;    // open connections
+        int busy = 0;           // checked out connections
+        int created = 0;
+        int reaped = 0;
+        int checkouts = 0;
+        int waits = 0;          // checkouts that had to wait
+        int timeouts = 0;
+        qint64 waitTime = 0;    // total wait in milliseconds
+        qint64 maxWaitTime = 0;
+    };
+
+    static ConnectionPool *instance();
+
+    void setMaxConnections(int count);
+    int maxConnections() const;
+
+    void setIdleTimeout(int msecs);
+    int idleTimeout() const;
+
+    void setStorageProfile(const QString &databaseName, StorageProfile::Profile profile);
+    StorageProfile::Profile storageProfile(const QString &databaseName) const;
+
+    QSqlDatabase threadConnection(const QString &databaseName = QString(), bool open = true);
+    QSqlDatabase checkout(const QString &databaseName, Mode mode = ReadMode, int timeout = -1);
+    void checkin(const QSqlDatabase &db);
+    bool open(QSqlDatabase &db, Mode mode = WriteMode);
+    bool lockWriter(const QString &databaseName, int timeout = -1);
+    void unlockWriter(const QString &databaseName);
+    void reap();
+
+    StatementCache *statements();
+    Metrics metrics() const;
+
+private:
+    struct ThreadConnections;
+    friend struct ThreadConnections;
+
+    ConnectionPool();
+    ThreadConnections *local();
+    void configure(QSqlDatabase &db, Mode mode);
+    void close(ThreadConnections *thread, int index);
+    bool acquireWriter(const QString &databaseName, const QElapsedTimer &clock, int timeout, bool *waited);
+    void releaseWriter(const QString &databaseName);
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_available;
+    QWaitCondition m_writerFree;
+    int m_maxConnections = 8;
+    int m_idleTimeout = 60000;
+    QHash<QString, StorageProfile::Profile> m_profiles;
+
+    struct Writer
+    {
+        Qt::HANDLE thread = nullptr;
+        int depth = 0;
+    };
+    QHash<QString, Writer> m_writers;   // by database name
+    Metrics m_metrics;
+    QVector<ThreadConnections *> m_registry;   // of all threads, for reap()
+
+    // last, so the connections of the main thread go before the rest
+    QThreadStorage<ThreadConnections *> m_threads;
+};
+
+/**
+ * @brief checks a connection out of the pool for the lifetime of the object
+ */
+class PooledConnection
+{
+    Q_DISABLE_COPY(PooledConnection)
+public:
+    explicit PooledConnection(const QString &databaseName,
+                              ConnectionPool::Mode mode = ConnectionPool::ReadMode,
+                              int timeout = -1);
+    ~PooledConnection();
+
+    QSqlDatabase database() const;
+    bool isOpen() const;
+
+private:
+    QSqlDatabase m_database;
+};
+
+/**
+ * @brief holds the writer lock of a database for the lifetime of the object,
+ * for writes on the thread connection
+ */
+class WriterLock
+{
+    Q_DISABLE_COPY(WriterLock)
+public:
+    explicit WriterLock(const QString &databaseName, int timeout = -1);
+    ~WriterLock();
+
+    bool isLocked() const;
+
+private:
+    QString m_databaseName;
+    bool m_locked = false;
+};
+
+#endif // CONNECTIONPOOL_H
@@ -0,0 +1,330 @@
+/**
+ * QML examples - Qt5 and QML examples
+ * Copyright (c) 2019 Yuri Young<yuri.young@qq.com>
+ *
+ * This examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "editqueue.h"
+#include "queryprofiler.h"
+#include "sql.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QSqlDriver>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QRunnable>
+#include <QLoggingCategory>
+
+Q_LOGGING_CATEGORY(lcEditQueue, "app.EditQueue")
+
+class FlushTask : public QRunnable
+{
+public:
+    FlushTask(EditQueue *queue, const EditQueue::Target &target, const QHash<qint64, EditQueue::Row> &rows)
+        : m_queue(queue), m_target(target), m_rows(rows)
+    {
+    }
+
+    void run() override
+    {
+        QVector<EditQueue::Edit> failed;
+        QString error;
+        const int rows = EditQueue::write(m_target, m_rows, &failed, &error);
+
+        // the queue is updated on its own thread
+        EditQueue *queue = m_queue;
+        QMetaObject::invokeMethod(queue, [queue, rows, failed, error]() {
+            queue->finishFlush(rows, failed, error);
+        }, Qt::QueuedConnection);
+    }
+
+private:
+    EditQueue *m_queue;
+    EditQueue::Target m_target;
+    QHash<qint64, EditQueue::Row> m_rows;
+};
+
+EditQueue::EditQueue(QObject *parent)
+    : QObject(parent)
+{
+    m_pool.setMaxThreadCount(1);
+    m_timer.setSingleShot(true);
+    m_timer.setInterval(500);
+    connect(&m_timer, &QTimer::timeout, this, &EditQueue::flush);
+}
+
+/**
+ * @brief the queued edits are written before the queue goes
+ */
+EditQueue::~EditQueue()
+{
+    waitForFlushed(-1);
+    m_pool.waitForDone();
+}
+
+/**
+ * @brief the table the edits are written to. edits queued for
+ * another table are written before the target changes.
+ * @param target
+ */
+void EditQueue::setTarget(const Target &target)
+{
+    if(m_target.databaseName == target.databaseName && m_target.table == target.table
+            && m_target.keyField == target.keyField && m_target.fields == target.fields)
+        return;
+
+    if(!waitForFlushed())
+        qWarning(lcEditQueue) << "Edits of" << m_target.table << "not written before the table changed";
+    m_target = target;
+}
+
+EditQueue::Target EditQueue::target() const
+{
+    return m_target;
+}
+
+/**
+ * @brief the time from the first queued edit to the flush
+ * @param msec
+ */
+void EditQueue::setInterval(int msec)
+{
+    m_timer.setInterval(qMax(0, msec));
+}
+
+int EditQueue::interval() const
+{
+    return m_timer.interval();
+}
+
+/**
+ * @brief the number of queued edits that flush without waiting for the interval
+ * @param edits
+ */
+void EditQueue::setThreshold(int edits)
+{
+    m_threshold = qMax(1, edits);
+}
+
+int EditQueue::threshold() const
+{
+    return m_threshold;
+}
+
+/**
+ * @brief queue the value of a cell, a later edit of the cell replaces it
+ * @param key the primary key of the row
+ * @param column
+ * @param value
+ */
+void EditQueue::set(qint64 key, int column, const QVariant &value)
+{
+    Row &row = m_pending[key];
+    if(!row.contains(column))
+        ++m_count;
+    row.insert(column, value);
+
+    if(m_count >= m_threshold)
+        flush();
+    else if(!m_timer.isActive())
+        m_timer.start();
+}
+
+/**
+ * @brief the value of a cell not yet in the database, the newest edit first
+ * @param key
+ * @param column
+ * @param found false if the cell has no queued edit
+ * @return
+ */
+QVariant EditQueue::value(qint64 key, int column, bool *found) const
+{
+    for (const QHash<qint64, Row> *rows : { &m_pending, &m_flushing })
+    {
+        auto row = rows->constFind(key);
+        if(row == rows->constEnd())
+            continue;
+
+        auto cell = row->constFind(column);
+        if(cell != row->constEnd())
+        {
+            *found = true;
+            return cell.value();
+        }
+    }
+
+    *found = false;
+    return QVariant();
+}
+
+bool EditQueue::isEmpty() const
+{
+    return m_pending.isEmpty() && m_flushing.isEmpty();
+}
+
+/**
+ * @brief the edits not yet written
+ * @return
+ */
+int EditQueue::count() const
+{
+    int count = m_count;
+    for (const Row &row : m_flushing)
+        count += row.count();
+    return count;
+}
+
+/**
+ * @brief flush and wait until every queued edit is written or failed.
+ * the results of the worker are taken on the calling thread, which has
+ * to be the thread of the queue.
+ * @param msecs -1 waits without a limit
+ * @return false on timeout
+ */
+bool EditQueue::waitForFlushed(int msecs)
+{
+    QElapsedTimer clock;
+    clock.start();
+    flush();
+    while (m_running)
+    {
+        const int remaining = msecs < 0 ? -1 : qMax(0, msecs - int(clock.elapsed()));
+        if(!m_pool.waitForDone(remaining))
+            return false;
+
+        // finishFlush() is posted to this thread, and may start the next flush
+        QCoreApplication::sendPostedEvents(this, QEvent::MetaCall);
+    }
+    return m_pending.isEmpty();
+}
+
+/**
+ * @brief write the queued edits on the worker thread, a flush in progress
+ * is followed by another one
+ */
+void EditQueue::flush()
+{
+    m_timer.stop();
+    if(m_pending.isEmpty())
+        return;
+
+    if(m_running)
+    {
+        m_again = true;
+        return;
+    }
+
+    if(m_target.databaseName.isEmpty() || m_target.table.isEmpty() || m_target.keyField.isEmpty())
+    {
+        qWarning(lcEditQueue) << "No table to write" << m_count << "edits to";
+        return;
+    }
+
+    m_flushing.swap(m_pending);
+    m_count = 0;
+    m_running = true;
+    m_pool.start(new FlushTask(this, m_target, m_flushing));
+}
+
+/**
+ * @brief one transaction for the rows, one UPDATE per row. rows that change
+ * the same columns share a prepared statement. a failing UPDATE is undone by
+ * sqlite on its own, so the other rows are still committed.
+ * @param target
+ * @param rows
+ * @param failed receives the edits that were not written
+ * @param error the last error
+ * @return the number of rows written
+ */
+int EditQueue::write(const Target &target, const QHash<qint64, Row> &rows,
+                     QVector<Edit> *failed, QString *error)
+{
+    auto failRow = [failed](qint64 key, const Row &row) {
+        for (auto cell = row.constBegin(); cell != row.constEnd(); ++cell)
+        {
+            Edit edit;
+            edit.key = key;
+            edit.column = cell.key();
+            edit.value = cell.value();
+            failed->append(edit);
+        }
+    };
+    auto failAll = [&](const QString &message) {
+        *error = message;
+        failed->clear();
+        for (auto it = rows.constBegin(); it != rows.constEnd(); ++it)
+            failRow(it.key(), it.value());
+        return 0;
+    };
+
+    PooledConnection connection(target.databaseName, ConnectionPool::WriteMode);
+    QSqlDatabase db = connection.database();
+    if(!db.isOpen())
+        return failAll("Can not open database " + db.lastError().text());
+
+    const bool transacted = db.driver()->hasFeature(QSqlDriver::Transactions);
+    if(transacted && !db.transaction())
+        return failAll("Can not begin transaction " + db.lastError().text());
+
+    int written = 0;
+    for (auto it = rows.constBegin(); it != rows.constEnd(); ++it)
+    {
+        QStringList assignments;
+        for (auto cell = it->constBegin(); cell != it->constEnd(); ++cell)
+            assignments << target.fields.value(cell.key()) + " = ?";
+
+        QSqlQuery query = Sql::statement(QString("UPDATE %1 SET %2 WHERE %3 = ?")
+                                         .arg(target.table, assignments.join(", "), target.keyField), db);
+        for (const QVariant &value : it.value())
+            query.addBindValue(value);
+        query.addBindValue(it.key());
+        if(QueryProfiler::exec(query, "edits"))
+        {
+            ++written;
+            continue;
+        }
+
+        *error = "Update record error " + query.lastError().text();
+        qWarning(lcEditQueue) << *error;
+        failRow(it.key(), it.value());
+    }
+
+    if(transacted && !db.commit())
+    {
+        const QString message = "Commit edits error " + db.lastError().text();
+        db.rollback();
+        return failAll(message);
+    }
+
+    return written;
+}
+
+void EditQueue::finishFlush(int rows, const QVector<Edit> &failedEdits, const QString &error)
+{
+    m_flushing.clear();
+    m_running = false;
+    qDebug(lcEditQueue) << "flushed" << rows << "rows," << failedEdits.count() << "edits failed";
+
+    if(!failedEdits.isEmpty())
+        emit failed(failedEdits, error);
+    emit flushed(rows);
+
+    if(m_again || m_count >= m_threshold)
+    {
+        m_again = false;
+        flush();
+    }
+}
@@ -0,0 +1,104 @@
+/**
+ * QML examples - Qt5 and QML examples
+ * Copyright (c) 2019 Yuri Young<yuri.young@qq.com>
+ *
+ * This examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EDITQUEUE_H
+#define EDITQUEUE_H
+
+#include <QObject>
+#include <QHash>
+#include <QMap>
+#include <QVector>
+#include <QVariant>
+#include <QStringList>
+#include <QTimer>
+#include <QThreadPool>
+
+/**
+ * @brief cell edits written behind: an edit is kept in memory, where it is
+ * read at once, and written later on a worker thread together with the
+ * edits queued meanwhile. one flush is one transaction with one UPDATE
+ * per row for all of its changed columns. a flush starts when the interval
+ * passed since the first queued edit, when threshold edits are queued or
+ * when flush() is called.
+ */
+class EditQueue : public QObject
+{
+    Q_OBJECT
+public:
+    struct Edit
+    {
+        qint64 key = 0;
+        int column = -1;
+        QVariant value;
+    };
+
+    // identifiers are escaped by the model
+    struct Target
+    {
+        QString databaseName;
+        QString table;
+        QString keyField;
+        QStringList fields;
+    };
+
+    explicit EditQueue(QObject *parent = nullptr);
+    ~EditQueue() override;
+
+    void setTarget(const Target &target);
+    Target target() const;
+
+    void setInterval(int msec);
+    int interval() const;
+
+    void setThreshold(int edits);
+    int threshold() const;
+
+    void set(qint64 key, int column, const QVariant &value);
+    QVariant value(qint64 key, int column, bool *found) const;
+    bool isEmpty() const;
+    int count() const;
+
+    bool waitForFlushed(int msecs = 30000);
+
+public slots:
+    void flush();
+
+signals:
+    void flushed(int rows);
+    void failed(const QVector<EditQueue::Edit> &edits, const QString &error);
+
+private:
+    friend class FlushTask;
+    typedef QMap<int, QVariant> Row;
+
+    static int write(const Target &target, const QHash<qint64, Row> &rows,
+                     QVector<Edit> *failed, QString *error);
+    void finishFlush(int rows, const QVector<Edit> &failedEdits, const QString &error);
+
+    Target m_target;
+    QHash<qint64, Row> m_pending;
+    QHash<qint64, Row> m_flushing;     // the rows the worker writes
+    int m_count = 0;                    // edits in m_pending
+    int m_threshold = 1000;
+    bool m_running = false;
+    bool m_again = false;               // flush() was called while running
+    QTimer m_timer;
+    QThreadPool m_pool;
+};
+
+#endif // EDITQUEUE_H
@@ -0,0 +1,469 @@
+/**
+ * QML examples - Qt5 and QML examples
+ * Copyright (c) 2019 Yuri Young<yuri.young@qq.com>
+ *
+ * This examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "importer.h"
+#include "statementcache.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QSqlDriver>
+#include <QSqlRecord>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QElapsedTimer>
+#include <QLoggingCategory>
+
+Q_LOGGING_CATEGORY(lcImporter, "app.Importer")
+
+// host parameters of one statement, the limit of sqlite before 3.32
+static const int maxVariables = 999;
+
+Importer::Importer(const QSqlDatabase &db)
+    : m_db(db)
+{
+}
+
+/**
+ * @brief rows inserted per transaction
+ * @param rows
+ */
+void Importer::setChunkSize(int rows)
+{
+    m_chunkSize = qMax(1, rows);
+}
+
+int Importer::chunkSize() const
+{
+    return m_chunkSize;
+}
+
+/**
+ * @brief drop the indexes of the table for the import and create them again
+ * at the end. indexes sqlite made for UNIQUE and PRIMARY KEY constraints stay.
+ * @param enabled
+ */
+void Importer::setDeferIndexes(bool enabled)
+{
+    m_deferIndexes = enabled;
+}
+
+bool Importer::deferIndexes() const
+{
+    return m_deferIndexes;
+}
+
+void Importer::setDelimiter(QChar delimiter)
+{
+    m_delimiter = delimiter;
+}
+
+QChar Importer::delimiter() const
+{
+    return m_delimiter;
+}
+
+/**
+ * @brief columns for fields not named like them, field name to column name
+ * @param fields
+ */
+void Importer::setMapping(const QHash<QString, QString> &fields)
+{
+    m_mapping = fields;
+}
+
+QHash<QString, QString> Importer::mapping() const
+{
+    return m_mapping;
+}
+
+Importer::Result Importer::import(const QString &fileName, const QString &table, Format format)
+{
+    QFile file(fileName);
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        Result result;
+        result.error = QString("Can not open file '%1' %2").arg(fileName, file.errorString());
+        qWarning(lcImporter) << result.error;
+        return result;
+    }
+
+    if(format == AutoFormat)
+    {
+        const QString suffix = QFileInfo(fileName).suffix().toLower();
+        format = (suffix == "json" || suffix == "jsonl" || suffix == "ndjson") ? JsonLinesFormat : CsvFormat;
+    }
+
+    return import(&file, table, format);
+}
+
+/**
+ * @brief import the records of the device into the table
+ * @param device
+ * @param table
+ * @param format AutoFormat reads CSV
+ * @return the rows committed, a failing chunk is rolled back
+ * and ends the import
+ */
+Importer::Result Importer::import(QIODevice *device, const QString &table, Format format)
+{
+    Result result;
+    QElapsedTimer clock;
+    clock.start();
+
+    const QSqlRecord record = m_db.record(table);
+    if(record.isEmpty())
+    {
+        result.error = QString("Can not open table '%1'").arg(table);
+        qWarning(lcImporter) << result.error;
+        return result;
+    }
+
+    QStringList columns;
+    for (int i = 0; i < record.count(); ++i)
+        columns << record.fieldName(i);
+
+    QTextStream stream(device);
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+    stream.setCodec("UTF-8");
+#else
+    stream.setEncoding(QStringConverter::Utf8);
+#endif
+
+    // the fields of the first record decide the columns
+    QStringList fields;
+    QJsonObject object;
+    bool firstObject = false;
+    if(format == JsonLinesFormat)
+    {
+        while (!stream.atEnd() && !firstObject)
+        {
+            const QByteArray line = stream.readLine().trimmed().toUtf8();
+            if(line.isEmpty())
+                continue;
+
+            const QJsonDocument document = QJsonDocument::fromJson(line);
+            if(!document.isObject())
+            {
+                ++result.skipped;
+                continue;
+            }
+            object = document.object();
+            fields = object.keys();
+            firstObject = true;
+        }
+    }
+    else
+    {
+        readCsv(stream, &fields);
+    }
+
+    QStringList targets;
+    QList<int> sources;
+    for (int i = 0; i < fields.count(); ++i)
+    {
+        const QString name = column(fields.at(i).trimmed(), columns);
+        if(name.isEmpty() || targets.contains(name))
+            continue;
+
+        targets << name;
+        sources << i;
+    }
+
+    if(targets.isEmpty())
+    {
+        result.error = QString("No field matches a column of '%1'").arg(table);
+        qWarning(lcImporter) << result.error;
+        return result;
+    }
+
+    QSqlDriver *driver = m_db.driver();
+    QStringList escaped;
+    for (const QString &name : targets)
+        escaped << driver->escapeIdentifier(name, QSqlDriver::FieldName);
+
+    const int width = targets.count();
+    const int perStatement = qMax(1, maxVariables / width);
+    const QString marks = "(" + QString("?, ").repeated(width - 1) + "?)";
+    auto statement = [&](int rows) {
+        QStringList values;
+        values.reserve(rows);
+        for (int i = 0; i < rows; ++i)
+            values << marks;
+        return QString("INSERT INTO %1 (%2) VALUES %3")
+                .arg(driver->escapeIdentifier(table, QSqlDriver::TableName), escaped.join(", "), values.join(", "));
+    };
+
+    QStringList indexes;
+    if(m_deferIndexes)
+    {
+        indexes = dropIndexes(table, &result.error);
+        if(!result.error.isEmpty())
+        {
+            createIndexes(indexes, &result.error);
+            qWarning(lcImporter) << result.error;
+            return result;
+        }
+    }
+
+    QSqlQuery batch = StatementCache::local()->prepare(m_db, statement(perStatement));
+    QVariantList values;
+    values.reserve(perStatement * width);
+    int chunk = 0;
+
+    auto insert = [&]() -> bool {
+        const int rows = values.count() / width;
+        QSqlQuery query = rows == perStatement ? batch : QSqlQuery(m_db);
+        if(rows != perStatement)
+            query.prepare(statement(rows));
+
+        for (int i = 0; i < values.count(); ++i)
+            query.bindValue(i, values.at(i));
+
+        if(!query.exec())
+        {
+            result.error = query.lastError().text();
+            return false;
+        }
+
+        chunk += rows;
+        values.clear();
+        return true;
+    };
+
+    auto commit = [&]() -> bool {
+        if(!values.isEmpty() && !insert())
+            return false;
+
+        if(!m_db.commit())
+        {
+            result.error = m_db.lastError().text();
+            return false;
+        }
+
+        result.rows += chunk;
+        chunk = 0;
+        return true;
+    };
+
+    m_db.transaction();
+    bool ok = true;
+    QStringList csv;
+    while (ok)
+    {
+        if(format == JsonLinesFormat)
+        {
+            if(!firstObject)
+            {
+                if(stream.atEnd())
+                    break;
+
+                const QByteArray line = stream.readLine().trimmed().toUtf8();
+                if(line.isEmpty())
+                    continue;
+
+                const QJsonDocument document = QJsonDocument::fromJson(line);
+                if(!document.isObject())
+                {
+                    ++result.skipped;
+                    continue;
+                }
+                object = document.object();
+            }
+            firstObject = false;
+
+            for (int source : sources)
+            {
+                const QJsonValue value = object.value(fields.at(source));
+                if(value.isDouble() && value.toDouble() == double(qint64(value.toDouble())))
+                    values << qint64(value.toDouble());
+                else if(value.isArray())
+                    values << QString::fromUtf8(QJsonDocument(value.toArray()).toJson(QJsonDocument::Compact));
+                else if(value.isObject())
+                    values << QString::fromUtf8(QJsonDocument(value.toObject()).toJson(QJsonDocument::Compact));
+                else
+                    values << value.toVariant();
+            }
+        }
+        else
+        {
+            if(!readCsv(stream, &csv))
+                break;
+            if(csv.count() == 1 && csv.first().isEmpty())
+                continue;
+
+            // fields missing at the end of a record are NULL
+            for (int source : sources)
+                values << (source < csv.count() ? QVariant(csv.at(source)) : QVariant());
+        }
+
+        if(values.count() == perStatement * width)
+            ok = insert();
+
+        if(ok && chunk >= m_chunkSize)
+        {
+            ok = commit();
+            if(ok)
+                m_db.transaction();
+        }
+    }
+
+    if(ok)
+        ok = commit();
+    if(!ok)
+        m_db.rollback();
+
+    if(!indexes.isEmpty())
+        createIndexes(indexes, &result.error);
+
+    result.elapsed = clock.elapsed();
+    result.rowsPerSecond = result.elapsed > 0 ? result.rows * 1000.0 / result.elapsed : result.rows;
+    if(result.error.isEmpty())
+        qInfo(lcImporter) << "imported" << result.rows << "rows into" << table << "in" << result.elapsed
+                          << "ms," << qRound(result.rowsPerSecond) << "rows/s";
+    else
+        qWarning(lcImporter) << "import into" << table << "failed after" << result.rows << "rows:" << result.error;
+
+    return result;
+}
+
+/**
+ * @brief read a CSV record, quoted fields may hold delimiters,
+ * line breaks and doubled quotes
+ * @param stream
+ * @param fields
+ * @return false at the end of the stream
+ */
+bool Importer::readCsv(QTextStream &stream, QStringList *fields) const
+{
+    fields->clear();
+    if(stream.atEnd())
+        return false;
+
+    QString field;
+    bool quoted = false;
+    QString line = stream.readLine();
+    forever
+    {
+        for (int i = 0; i < line.size(); ++i)
+        {
+            const QChar c = line.at(i);
+            if(quoted)
+            {
+                if(c != '"')
+                    field += c;
+                else if(i + 1 < line.size() && line.at(i + 1) == '"')
+                    field += line.at(++i);
+                else
+                    quoted = false;
+            }
+            else if(c == '"' && field.isEmpty())
+                quoted = true;
+            else if(c == m_delimiter)
+            {
+                *fields << field;
+                field.clear();
+            }
+            else
+                field += c;
+        }
+
+        if(!quoted || stream.atEnd())
+            break;
+
+        field += '\n';
+        line = stream.readLine();
+    }
+
+    *fields << field;
+    return true;
+}
+
+QString Importer::column(const QString &field, const QStringList &columns) const
+{
+    const QString name = m_mapping.value(field, field);
+    for (const QString &column : columns)
+    {
+        if(!column.compare(name, Qt::CaseInsensitive))
+            return column;
+    }
+
+    return QString();
+}
+
+/**
+ * @brief drop the indexes of the table that were created by a statement
+ * @param table
+ * @param error
+ * @return the statements to create the dropped indexes again
+ */
+QStringList Importer::dropIndexes(const QString &table, QString *error)
+{
+    QStringList names, statements;
+    QSqlQuery query(m_db);
+    query.prepare("SELECT name, sql FROM sqlite_master WHERE type = 'index' AND tbl_name = ? AND sql IS NOT NULL");
+    query.addBindValue(table);
+    if(!query.exec())
+    {
+        *error = query.lastError().text();
+        return statements;
+    }
+
+    while (query.next())
+    {
+        names << query.value(0).toString();
+        statements << query.value(1).toString();
+    }
+    query.finish();
+
+    QStringList dropped;
+    for (int i = 0; i < names.count(); ++i)
+    {
+        if(!query.exec("DROP INDEX " + m_db.driver()->escapeIdentifier(names.at(i), QSqlDriver::TableName)))
+        {
+            *error = query.lastError().text();
+            break;
+        }
+        dropped << statements.at(i);
+    }
+
+    return dropped;
+}
+
+bool Importer::createIndexes(const QStringList &statements, QString *error)
+{
+    QSqlQuery query(m_db);
+    for (const QString &statement : statements)
+    {
+        if(!query.exec(statement))
+        {
+            qWarning(lcImporter) << "Can not create index again:" << statement << query.lastError().text();
+            if(error->isEmpty())
+                *error = query.lastError().text();
+            return false;
+        }
+    }
+
+    if(!statements.isEmpty())
+        query.exec("ANALYZE");
+
+    return true;
+}
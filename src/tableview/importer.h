@@ -0,0 +1,85 @@
+/**
+ * QML examples - Qt5 and QML examples
+ * Copyright (c) 2019 Yuri Young<yuri.young@qq.com>
+ *
+ * This examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IMPORTER_H
+#define IMPORTER_H
+
+#include <QSqlDatabase>
+#include <QStringList>
+#include <QHash>
+
+class QIODevice;
+class QTextStream;
+
+/**
+ * @brief streams CSV or NDJSON records into a table.
+ * fields are matched to the columns of the table by name, the first line
+ * of a CSV file names them, the first object of an NDJSON file does.
+ * rows are inserted by a prepared multi-row INSERT, a chunk of rows per
+ * transaction. indexes of the table can be dropped for the import and
+ * created again at the end, which is faster than updating them per row.
+ */
+class Importer
+{
+public:
+    enum Format {
+        AutoFormat = 0,     // by the file suffix, .json/.jsonl/.ndjson or CSV
+        CsvFormat,
+        JsonLinesFormat
+    };
+
+    struct Result
+    {
+        int rows = 0;
+        int skipped = 0;        // records that could not be read
+        qint64 elapsed = 0;     // milliseconds
+        qreal rowsPerSecond = 0;
+        QString error;
+    };
+
+    explicit Importer(const QSqlDatabase &db);
+
+    void setChunkSize(int rows);
+    int chunkSize() const;
+
+    void setDeferIndexes(bool enabled);
+    bool deferIndexes() const;
+
+    void setDelimiter(QChar delimiter);
+    QChar delimiter() const;
+
+    void setMapping(const QHash<QString, QString> &fields);
+    QHash<QString, QString> mapping() const;
+
+    Result import(const QString &fileName, const QString &table, Format format = AutoFormat);
+    Result import(QIODevice *device, const QString &table, Format format);
+
+private:
+    bool readCsv(QTextStream &stream, QStringList *fields) const;
+    QString column(const QString &field, const QStringList &columns) const;
+    QStringList dropIndexes(const QString &table, QString *error);
+    bool createIndexes(const QStringList &statements, QString *error);
+
+    QSqlDatabase m_db;
+    int m_chunkSize = 50000;
+    bool m_deferIndexes = false;
+    QChar m_delimiter = ',';
+    QHash<QString, QString> m_mapping;
+};
+
+#endif // IMPORTER_H
@@ -0,0 +1,213 @@
+/**
+ * QML examples - Qt5 and QML examples
+ * Copyright (c) 2019 Yuri Young<yuri.young@qq.com>
+ *
+ * This examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "indexadvisor.h"
+#include "migration.h"
+#include "sql.h"
+
+#include <QSqlDriver>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QLoggingCategory>
+
+Q_LOGGING_CATEGORY(lcIndexAdvisor, "app.IndexAdvisor")
+
+namespace {
+
+class IndexTask : public QRunnable
+{
+public:
+    IndexTask(const QString &databaseName, const QString &table, const QStringList &columns, const QString &where)
+        : m_databaseName(databaseName), m_table(table), m_columns(columns), m_where(where)
+    {
+    }
+
+    void run() override
+    {
+        PooledConnection connection(m_databaseName, ConnectionPool::WriteMode);
+        QSqlDatabase db = connection.database();
+        if(!db.isOpen())
+        {
+            qWarning(lcIndexAdvisor) << "Can not open database" << db.lastError().text();
+            return;
+        }
+
+        if(IndexAdvisor::hasIndex(db, m_table, m_columns, m_where))
+            return;
+
+        if(IndexAdvisor::createIndex(db, m_table, m_columns, m_where))
+            qDebug(lcIndexAdvisor) << "created index" << IndexAdvisor::indexName(m_table, m_columns, m_where);
+    }
+
+private:
+    QString m_databaseName;
+    QString m_table;
+    QStringList m_columns;
+    QString m_where;
+};
+
+} // namespace
+
+IndexAdvisor::IndexAdvisor(int threshold)
+    : m_threshold(qMax(1, threshold))
+{
+}
+
+void IndexAdvisor::setThreshold(int uses)
+{
+    m_threshold = qMax(1, uses);
+}
+
+int IndexAdvisor::threshold() const
+{
+    return m_threshold;
+}
+
+/**
+ * @brief count a query that sorts or filters on columns, the columns are
+ * in index order: equality filters first, then the sort or range column.
+ * the index holds only these columns, it is not covering: it finds and
+ * orders the rows, the selected fields are still read from the table.
+ * @param databaseName
+ * @param table
+ * @param columns
+ * @param where the condition every such query has, the index is partial on it
+ */
+void IndexAdvisor::use(const QString &databaseName, const QString &table, const QStringList &columns,
+                       const QString &where)
+{
+    if(databaseName.isEmpty() || table.isEmpty() || columns.isEmpty())
+        return;
+
+    const QString key = databaseName + '\n' + indexName(table, columns, where);
+    if(m_requested.contains(key) || ++m_uses[key] < m_threshold)
+        return;
+
+    m_requested.insert(key);
+    m_uses.remove(key);
+    QThreadPool::globalInstance()->start(new IndexTask(databaseName, table, columns, where));
+}
+
+/**
+ * @brief index_<table>_<columns>, a partial index ends with its condition:
+ * index_books_title_where_deleted_at_is_null
+ * @param table
+ * @param columns
+ * @param where
+ * @return
+ */
+QString IndexAdvisor::indexName(const QString &table, const QStringList &columns, const QString &where)
+{
+    QString name = QString("index_%1_%2").arg(table, columns.join("_"));
+    if(where.isEmpty())
+        return name;
+
+    name += "_where";
+    bool inWord = false;
+    for (const QChar &c : where.toLower())
+    {
+        if(c.isLetterOrNumber())
+        {
+            if(!inWord)
+                name += '_';
+            name += c;
+            inWord = true;
+        }
+        else
+        {
+            inWord = false;
+        }
+    }
+    return name;
+}
+
+/**
+ * @brief whether an index of the table starts with the columns,
+ * such an index serves the query as well as a new one would.
+ * a partial index only serves queries with its condition.
+ * @param db
+ * @param table
+ * @param columns
+ * @param where
+ * @return
+ */
+bool IndexAdvisor::hasIndex(const QSqlDatabase &db, const QString &table, const QStringList &columns,
+                            const QString &where)
+{
+    QSqlQuery indexes(db);
+    if(!indexes.exec(QString("PRAGMA index_list(%1)")
+                     .arg(db.driver()->escapeIdentifier(table, QSqlDriver::TableName))))
+        return false;
+
+    QStringList names;
+    while (indexes.next())
+    {
+        if(!indexes.value("partial").toBool())
+            names << indexes.value("name").toString();
+        else if(!where.isEmpty() && indexes.value("name").toString() == indexName(table, columns, where))
+            return true;
+    }
+
+    for (const QString &name : names)
+    {
+        QSqlQuery info(db);
+        if(!info.exec(QString("PRAGMA index_info(%1)")
+                      .arg(db.driver()->escapeIdentifier(name, QSqlDriver::TableName))))
+            continue;
+
+        // rows come in seqno order
+        QStringList indexed;
+        while (info.next())
+            indexed << info.value("name").toString();
+
+        if(indexed.mid(0, columns.count()) == columns)
+            return true;
+    }
+
+    return false;
+}
+
+bool IndexAdvisor::createIndex(const QSqlDatabase &db, const QString &table, const QStringList &columns,
+                               const QString &where)
+{
+    // ANALYZE of the new index only lets the planner weigh it against the
+    // others, without a scan of every table of the database
+    const QString name = indexName(table, columns, where);
+    Migration migration(db);
+    return migration.runStatements(name, { createStatement(db, table, columns, where),
+                                           "ANALYZE " + db.driver()->escapeIdentifier(name, QSqlDriver::TableName) });
+}
+
+QString IndexAdvisor::createStatement(const QSqlDatabase &db, const QString &table, const QStringList &columns,
+                                      const QString &where)
+{
+    QSqlDriver *driver = db.driver();
+    QStringList fields;
+    for (const QString &column : columns)
+        fields << driver->escapeIdentifier(column, QSqlDriver::FieldName);
+
+    QString statement = QString("CREATE INDEX IF NOT EXISTS %1 ON %2 (%3)")
+            .arg(driver->escapeIdentifier(indexName(table, columns, where), QSqlDriver::TableName),
+                 driver->escapeIdentifier(table, QSqlDriver::TableName),
+                 fields.join(", "));
+    if(!where.isEmpty())
+        statement += " WHERE " + where;
+    return statement;
+}
@@ -0,0 +1,63 @@
+/**
+ * QML examples - Qt5 and QML examples
+ * Copyright (c) 2019 Yuri Young<yuri.young@qq.com>
+ *
+ * This examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INDEXADVISOR_H
+#define INDEXADVISOR_H
+
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+
+class QSqlDatabase;
+
+/**
+ * @brief creates indexes for the sorts and filters a model runs often.
+ * each use of a column list is counted, once it reaches the threshold the
+ * index is created on a pool thread as a migration named
+ * index_<table>_<columns>, unless an index starting with the columns exists.
+ * a where condition makes the index partial, it then only holds the rows
+ * the condition matches, e.g. the active rows of a soft delete table.
+ * the indexes are (equality columns, sort column), not covering indexes.
+ */
+class IndexAdvisor
+{
+public:
+    explicit IndexAdvisor(int threshold = 3);
+
+    void setThreshold(int uses);
+    int threshold() const;
+
+    void use(const QString &databaseName, const QString &table, const QStringList &columns,
+             const QString &where = QString());
+
+    static QString indexName(const QString &table, const QStringList &columns,
+                             const QString &where = QString());
+    static bool hasIndex(const QSqlDatabase &db, const QString &table, const QStringList &columns,
+                         const QString &where = QString());
+    static bool createIndex(const QSqlDatabase &db, const QString &table, const QStringList &columns,
+                            const QString &where = QString());
+    static QString createStatement(const QSqlDatabase &db, const QString &table, const QStringList &columns,
+                                   const QString &where = QString());
+
+private:
+    int m_threshold;
+    QHash<QString, int> m_uses;
+    QSet<QString> m_requested;
+};
+
+#endif // INDEXADVISOR_H
@@ -1,9 +1,20 @@
 #include <QGuiApplication>
 #include <QQmlApplicationEngine>
+#include <QQmlEngine>
+#include <QCommandLineParser>
+#include <QTextStream>
+#include <QElapsedTimer>
+
+#include <algorithm>
 
 #include "sql.h"
 #include "migration.h"
+#include "migrationbundle.h"
 #include "tablemodel.h"
+#include "benchmark.h"
+#include "importer.h"
+#include "parallelmigration.h"
+#include "queryprofiler.h"
 
 int main(int argc, char *argv[])
 {
@@ -12,18 +23,135 @@ int main(int argc, char *argv[])
 #endif
     QGuiApplication app(argc, argv);
 
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption benchmarkOption("benchmark", "Measure the storage profiles and quit.");
+    QCommandLineOption rowsOption("rows", "Rows generated by the benchmark.", "count", "100000");
+    QCommandLineOption profileOption("storage-profile", "default, readHeavy, writeHeavy or inMemory.", "name");
+    QCommandLineOption importOption("import", "Import a CSV or NDJSON file into the table and quit.", "file");
+    QCommandLineOption tableOption("table", "Table the import goes to.", "name", "books");
+    QCommandLineOption migrateOption("migrate", "Migrate database files, wildcards allowed, and quit.", "files");
+    QCommandLineOption traceOption("trace", "Profile the statements and write a Chrome trace at exit.", "file");
+    QCommandLineOption checkBundleOption("check-bundle", "Check the migration bundle against the migration scripts and quit.");
+    parser.addOptions({ benchmarkOption, rowsOption, profileOption, importOption, tableOption, migrateOption, traceOption,
+                        checkBundleOption });
+    parser.process(app);
+
+    if(parser.isSet(traceOption))
+        QueryProfiler::instance()->setEnabled(true);
+
+    const QStringList files = {
+        ":/migrations/001_books.sql",
+        ":/migrations/003_books_fts.sql",
+        ":/migrations/004_books_deleted.sql",
+        ":/migrations/005_books_changes.sql"
+    };
+    // the full-text index needs the fts5 trigram tokenizer, SQLite 3.34+,
+    // without it search falls back to LIKE
+    const QStringList optional = { "003_books_fts" };
+
+    if(parser.isSet(checkBundleOption))
+    {
+        MigrationBundle bundle;
+        if(!bundle.load(":/migrations.bundle"))
+        {
+            QTextStream(stderr) << "Can not load the migration bundle " << bundle.errorString() << '\n';
+            return 1;
+        }
+
+        const QStringList problems = bundle.verify(files);
+        for (const QString &problem : problems)
+            QTextStream(stderr) << problem << '\n';
+        return problems.isEmpty() ? 0 : 1;
+    }
+
+    if(parser.isSet(benchmarkOption))
+    {
+        Benchmark benchmark(files);
+        benchmark.setRows(parser.value(rowsOption).toInt());
+        benchmark.setOptional(optional);
+        QTextStream(stdout) << Benchmark::report(benchmark.runAll());
+        return 0;
+    }
+
+    if(parser.isSet(migrateOption))
+    {
+        QStringList databases;
+        for (const QString &value : parser.values(migrateOption))
+        {
+            if(value.contains('*') || value.contains('?'))
+                databases << ParallelMigration::databases(value);
+            else
+                databases << value;
+        }
+
+        MigrationBundle bundle;
+        bundle.load(":/migrations.bundle");
+        ParallelMigration migration = bundle.isEmpty() ? ParallelMigration(files) : ParallelMigration(bundle);
+        migration.setOptional(optional);
+        QElapsedTimer clock;
+        clock.start();
+        const QVector<ParallelMigration::Result> results = migration.run(databases);
+        QTextStream(stdout) << ParallelMigration::report(results, clock.elapsed());
+        return std::all_of(results.begin(), results.end(), [](const ParallelMigration::Result &result) {
+            return result.ok;
+        }) ? 0 : 1;
+    }
+
+    if(parser.isSet(profileOption))
+    {
+        bool ok = false;
+        const StorageProfile::Profile profile = StorageProfile::fromName(parser.value(profileOption), &ok);
+        if(!ok)
+            qWarning() << "Unknown storage profile" << parser.value(profileOption);
+        ConnectionPool::instance()->setStorageProfile("data.db", profile);
+    }
+
     // create database and tables
     {
-        QStringList files = { ":/migrations/001_books.sql" };
         Migration migration(Sql::database("data.db"));
-        if(!migration.run(files))
+        migration.setSingleTransaction(true);
+        migration.setOptional(optional);
+
+        // the bundle is built from migrations/ with the application
+        MigrationBundle bundle;
+        bool ok = false;
+        if(bundle.load(":/migrations.bundle"))
+        {
+            ok = migration.run(bundle);
+        }
+        else
+        {
+            qWarning() << "Can not load the migration bundle" << bundle.errorString();
+            ok = migration.run(files);
+        }
+        // the schema only changes with a migration
+        if(ok && migration.migrated())
+            ok = migration.createSoftDeleteIndexes();
+
+        if(!ok)
         {
             qWarning() << "Create migration table(s) failed in database"
                                    << migration.connection().databaseName();
         }
     }
 
+    if(parser.isSet(importOption))
+    {
+        Importer importer(Sql::database());
+        importer.setDeferIndexes(true);
+        const Importer::Result result = importer.import(parser.value(importOption), parser.value(tableOption));
+        QTextStream(stdout) << QString("%1 rows, %2 skipped, %3 ms, %4 rows/s\n")
+                               .arg(result.rows).arg(result.skipped).arg(result.elapsed).arg(qRound(result.rowsPerSecond));
+        return result.error.isEmpty() ? 0 : 1;
+    }
+
     qmlRegisterType<TableModel>("Macai.App", 1, 0, "SqlTableModel");
+    qmlRegisterSingletonType<QueryProfiler>("Macai.App", 1, 0, "Profiler", [](QQmlEngine *, QJSEngine *) -> QObject * {
+        QueryProfiler *profiler = QueryProfiler::instance();
+        QQmlEngine::setObjectOwnership(profiler, QQmlEngine::CppOwnership);
+        return profiler;
+    });
 
     QQmlApplicationEngine engine;
     const QUrl url(QStringLiteral("qrc:/main.qml"));
@@ -34,5 +162,9 @@ int main(int argc, char *argv[])
     }, Qt::QueuedConnection);
     engine.load(url);
 
-    return app.exec();
+    const int code = app.exec();
+    if(parser.isSet(traceOption))
+        QueryProfiler::instance()->writeTrace(parser.value(traceOption));
+
+    return code;
 }
@@ -21,7 +21,8 @@ Window {
         rowSpacing: 0
         clip: true
 
-        contentHeight: rowHeightProvider(0) * rows + rowHeightProvider(rows-1)
+        // sized by the row count of the table, not by the rows fetched so far
+        contentHeight: rowHeightProvider(0) * Math.max(rows, tableModel.totalRows) + rowHeightProvider(rows-1)
         leftMargin: vericalHeader.implicitWidth
         topMargin: horizontalHeader.implicitHeight
         rowHeightProvider: function (row) { return 32; }
@@ -32,10 +33,29 @@ Window {
         ScrollIndicator.horizontal: ScrollIndicator {}
         ScrollIndicator.vertical: ScrollIndicator { active: true }
 
+        onAtYEndChanged: {
+            if (atYEnd && tableModel.canFetchMore())
+                tableModel.fetchMore()
+        }
+
+        // the model reads the pages ahead of a flick before they are shown
+        onContentYChanged: {
+            var rowHeight = rowHeightProvider(0)
+            var first = Math.max(0, Math.floor((contentY + topMargin) / rowHeight))
+            tableModel.setViewport(first, first + Math.ceil(height / rowHeight), verticalVelocity / rowHeight)
+        }
+
         model: SqlTableModel {
             id: tableModel
             database: "data.db"
             table: "books"
+            paged: true
+            async: true
+            pageSize: 200
+            internedColumns: ["author", "publisher"]
+            lazyColumns: ["description"]
+            scope: SqlTableModel.ActiveScope
+            writeBehind: true
         }
 
         delegate: Rectangle {
@@ -95,6 +115,13 @@ Window {
                     width: tableView.columnWidthProvider(index)
                     height: tableView.rowHeightProvider(index)
                     text: tableModel.headerData(index, Qt.Horizontal)
+                          + (tableModel.sortColumn === index
+                             ? (tableModel.sortOrder === Qt.AscendingOrder ? " ▲" : " ▼") : "")
+                    onClicked: {
+                        var order = tableModel.sortColumn === index && tableModel.sortOrder === Qt.AscendingOrder
+                                ? Qt.DescendingOrder : Qt.AscendingOrder
+                        tableModel.sort(index, order)
+                    }
                 }
             }
         }
@@ -122,6 +149,14 @@ Window {
         }
     }
 
+    ProgressBar {
+        anchors.left: parent.left
+        anchors.right: parent.right
+        anchors.bottom: parent.bottom
+        visible: tableModel.loading
+        value: tableModel.progress
+    }
+
     Component {
         id: highlightComponent
         Rectangle {
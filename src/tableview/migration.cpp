@@ -26,9 +26,16 @@
 */
 
 #include "migration.h"
+#include "statementcache.h"
+#include "sqlstatementreader.h"
+#include "migrationbundle.h"
+#include "queryprofiler.h"
+#include "indexadvisor.h"
 
 #include <QSet>
+#include <QHash>
 #include <QDir>
+#include <QFile>
 #include <QSqlDatabase>
 #include <QSqlDriver>
 #include <QSqlQuery>
@@ -36,12 +43,6 @@
 #include <QSqlError>
 #include <QLoggingCategory>
 
-#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
-#include <QRegExp>
-#else
-#include <QRegularExpression>
-#endif
-
 Q_LOGGING_CATEGORY(lcMigration, "app.Migration")
 
 class MigrationPrivate
@@ -49,6 +50,7 @@ class MigrationPrivate
     Q_DECLARE_PUBLIC(Migration)
 public:
     bool migrationExists(const QString &name);
+    void loadState();
     QStringList migrations();
     void pendingMigration(const QStringList &files);
     QStringList migrationFiles(const QString &path);
@@ -57,30 +59,86 @@ public:
     QString resolveInstance(const QString &fileName);
 
     int lastBatch = 0;
+    bool batching = false;      // one batch number for all files of a run
+    bool singleTransaction = false;
+    bool stateLoaded = false;
+    bool migrated = false;      // the last run applied a migration
+    QSet<QString> optional;     // migrations that may fail, see setOptional()
+    QSet<QString> applied;
+    QHash<QString, QByteArray> hashes;  // sha256 of the applied bundle migrations
+    QSet<QString> tables;
     QSet<QString> files;
     QSqlDatabase connection;
     Migration *q_ptr = nullptr;
 };
 
+/**
+ * @brief a migration ran before if the repository has it, or, for migrations
+ * run before the repository existed, if the table it creates exists.
+ * migrations that do not create a table of their name rely on the repository.
+ * @param name
+ * @return
+ */
 bool MigrationPrivate::migrationExists(const QString &name)
 {
+    if(!stateLoaded)
+        loadState();
+
+    if(applied.contains(name))
+        return true;
+
     const QString instanceName = this->resolveInstance(name);
-    bool exists = connection.tables().contains(instanceName);
-//    if(exists)
-//    {
-        // migration respository dose not exists? --never mine
-//        this->toRepository(name);
-//    }
+    return tables.contains(instanceName);
+}
+
+/**
+ * @brief read the applied migrations, their hashes and the tables once
+ * for a run, instead of for every file
+ */
+void MigrationPrivate::loadState()
+{
+    Q_Q(Migration);
+    applied.clear();
+    hashes.clear();
+    QSqlQuery query = StatementCache::local()->prepare(connection, QString("SELECT migration, hash FROM %1").arg(q->table()));
+    if(!query.exec())
+        qCritical(lcMigration()) << "Migration error:" << query.lastError().text();
 
-    return exists;
+    while (query.next())
+    {
+        const QString name = query.value(0).toString();
+        const QByteArray hash = QByteArray::fromHex(query.value(1).toByteArray());
+        applied.insert(name);
+        if(!hash.isEmpty())
+            hashes.insert(name, hash);
+    }
+    query.finish();
+
+    const QStringList tableNames = connection.tables();
+#if (QT_VERSION < QT_VERSION_CHECK(5, 14, 0))
+    tables = tableNames.toSet();
+#else
+    tables = QSet<QString>(tableNames.begin(), tableNames.end());
+#endif
+    stateLoaded = true;
+}
+
+/**
+ * @brief the number prefix of a migration name, 3 for 003_books_fts
+ * @param name
+ * @return
+ */
+static int migrationVersion(const QString &name)
+{
+    return name.section('_', 0, 0).toInt();
 }
 
 QStringList MigrationPrivate::migrations()
 {
     Q_Q(Migration);
     QStringList migrations;
-    QSqlQuery query(connection);
-    if(!query.exec(QString("SELECT DISTINCT migration FROM %1").arg(q->table())))
+    QSqlQuery query = StatementCache::local()->prepare(connection, QString("SELECT DISTINCT migration FROM %1").arg(q->table()));
+    if(!query.exec())
     {
         qCritical(lcMigration()) << "Migration error:" << query.lastError().text();
         return migrations;
@@ -146,7 +204,8 @@ QString MigrationPrivate::migrationName(const QString &file)
 }
 
 /**
- * @brief resolve a migrationn sql statements from a file
+ * @brief resolve a migrationn sql statements from a file,
+ * migrateUp() reads them one at a time instead
  * @param file
  * @return
  */
@@ -160,18 +219,12 @@ QStringList MigrationPrivate::resolveStatements(const QString &file)
         return statements;
     }
 
-    const QString sql = sqlFile.readAll().trimmed();
-    sqlFile.close();
+    SqlStatementReader reader(&sqlFile);
+    while (reader.next())
+        statements << reader.statement();
 
-#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
-    static QRegExp re(";");
-    statements = sql.split(re, QString::SkipEmptyParts);
-#else
-    static QRegularExpression re(";");
-    statements = sql.split(re, Qt::SkipEmptyParts);
-#endif
-//    if(statements.last() == "\n" || statements.last() == "\r\n")
-//        statements.removeLast();
+    if(reader.hasError())
+        qCritical(lcMigration) << "Can not read file '" << file << "' " << reader.errorString();
 
     return statements;
 }
@@ -236,6 +289,60 @@ QSqlDatabase Migration::connection() const
     return d->connection;
 }
 
+/**
+ * @brief run all pending files in one transaction, with a savepoint
+ * per file, instead of a transaction per file
+ * @param enabled
+ */
+void Migration::setSingleTransaction(bool enabled)
+{
+    Q_D(Migration);
+    d->singleTransaction = enabled;
+}
+
+bool Migration::singleTransaction() const
+{
+    Q_D(const Migration);
+    return d->singleTransaction;
+}
+
+/**
+ * @brief migrations, by name, whose failure is logged and does not fail the
+ * run, e.g. 003_books_fts, the trigram tokenizer needs SQLite 3.34+.
+ * a failed optional migration is rolled back and tried again on the next run.
+ * @param migrations
+ */
+void Migration::setOptional(const QStringList &migrations)
+{
+    Q_D(Migration);
+#if (QT_VERSION < QT_VERSION_CHECK(5, 14, 0))
+    d->optional = migrations.toSet();
+#else
+    d->optional = QSet<QString>(migrations.begin(), migrations.end());
+#endif
+}
+
+QStringList Migration::optional() const
+{
+    Q_D(const Migration);
+#if (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))
+    return d->optional.toList();
+#else
+    return d->optional.values();
+#endif
+}
+
+/**
+ * @brief whether the last run applied a migration, work that follows the
+ * schema, like createSoftDeleteIndexes(), is only needed then
+ * @return
+ */
+bool Migration::migrated() const
+{
+    Q_D(const Migration);
+    return d->migrated;
+}
+
 QStringList Migration::files() const
 {
     Q_D(const Migration);
@@ -263,6 +370,7 @@ bool Migration::run(const QStringList &files)
     if(!d->connection.isOpen())
         d->connection.open();
 
+    d->migrated = false;
     // initialize migration repository
     this->createRepository();
 
@@ -273,11 +381,10 @@ bool Migration::run(const QStringList &files)
         return true;
     }
 
-#if (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))
-    return d->files.toList();
-#else
-    return this->runMigration(d->files.values());
-#endif
+    // run in file name order, later migrations build on earlier ones
+    QStringList pending = this->files();
+    pending.sort();
+    return this->runMigration(pending);
 }
 
 /**
@@ -297,6 +404,7 @@ bool Migration::run(const QString &path)
     if(!d->connection.isOpen())
         d->connection.open();
 
+    d->migrated = false;
     // initialize migration repository
     this->createRepository();
 
@@ -307,11 +415,252 @@ bool Migration::run(const QString &path)
         qWarning(lcMigration) << "Nothing to migrate.";
         return true;
     }
-#if (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))
-    return d->files.toList();
-#else
-    return this->runMigration(d->files.values());
-#endif
+    // run in file name order, later migrations build on earlier ones
+    QStringList pending = this->files();
+    pending.sort();
+    return this->runMigration(pending);
+}
+
+/**
+ * @brief run the migrations of a bundle the database does not have yet.
+ * the schema version of the database is kept in PRAGMA user_version,
+ * when it is not older than the bundle nothing else is read.
+ * each migration runs in a savepoint: a failing one is rolled back, the
+ * ones before it are committed and user_version is the last of them.
+ * a failing optional migration is skipped, user_version stays before it
+ * so it is tried again.
+ * an applied migration whose script changed since, by its sha256 in the
+ * repository, fails the run before anything is executed.
+ * @param bundle
+ * @return
+ */
+bool Migration::run(const MigrationBundle &bundle)
+{
+    Q_D(Migration);
+    if(!d->connection.isValid())
+    {
+        qWarning(lcMigration) << "Invalid connection.";
+        return false;
+    }
+
+    if(!d->connection.isOpen())
+        d->connection.open();
+
+    d->migrated = false;
+    const int current = this->schemaVersion();
+    if(current >= bundle.schemaVersion())
+        return true;
+
+    // initialize migration repository
+    this->createRepository();
+    d->loadState();
+
+    const QVector<MigrationBundle::Entry> entries = bundle.migrations();
+    for (const MigrationBundle::Entry &entry : entries)
+    {
+        const QByteArray hash = d->hashes.value(entry.name);
+        if(!hash.isEmpty() && hash != entry.hash)
+        {
+            qCritical(lcMigration) << "Migration '" << entry.name << "' changed after it was applied";
+            d->stateLoaded = false;
+            return false;
+        }
+    }
+
+    d->lastBatch = this->lastBatchNumber() + 1;
+    d->batching = true;
+
+    bool transacted = d->connection.driver()->hasFeature(QSqlDriver::Transactions);
+    if(transacted)
+        d->connection.transaction();
+
+    QSqlQuery query(d->connection);
+    QSqlQuery savepoint(d->connection);
+    bool ok = true;
+    bool complete = true;       // no optional migration was skipped
+    int version = current;
+    int count = 0;
+    for (const MigrationBundle::Entry &entry : entries)
+    {
+        if(d->migrationExists(entry.name))
+        {
+            if(complete)
+                version = qMax(version, migrationVersion(entry.name));
+            continue;
+        }
+
+        const QString point = QString("migration_%1").arg(count++);
+        if(transacted)
+            savepoint.exec("SAVEPOINT " + point);
+
+        for (const QString &cmd : entry.statements)
+        {
+            if(!QueryProfiler::exec(query, cmd, "migration"))
+            {
+                qCritical(lcMigration) << "Migration up error '" << entry.name << "' " << query.lastError().text();
+                qCritical(lcMigration) << cmd.left(1024);
+                ok = false;
+                break;
+            }
+            query.finish();
+        }
+
+        if(!ok || !this->toRepository(entry.name, entry.hash))
+        {
+            if(transacted)
+            {
+                savepoint.exec("ROLLBACK TO " + point);
+                savepoint.exec("RELEASE " + point);
+            }
+            if(d->optional.contains(entry.name))
+            {
+                qWarning(lcMigration) << "Optional migration skipped:" << entry.name;
+                ok = true;
+                complete = false;
+                continue;
+            }
+            ok = false;
+            break;
+        }
+
+        if(transacted)
+            savepoint.exec("RELEASE " + point);
+        d->migrated = true;
+        if(complete)
+            version = qMax(version, migrationVersion(entry.name));
+        qDebug(lcMigration) << "migrated" << entry.name << entry.hash.toHex().left(12);
+    }
+
+    // user_version is written in the transaction of the migrations,
+    // it is the last migration that succeeded
+    if(ok && complete)
+        version = bundle.schemaVersion();
+    if(version > current && !query.exec(QString("PRAGMA user_version = %1").arg(version)))
+    {
+        qCritical(lcMigration) << "Migration error:" << query.lastError().text();
+        ok = false;
+        if(transacted)
+        {
+            d->connection.rollback();
+            transacted = false;
+        }
+    }
+
+    if(transacted && !d->connection.commit())
+    {
+        qCritical(lcMigration) << "Migration commit error" << d->connection.lastError().text();
+        d->connection.rollback();
+        ok = false;
+    }
+
+    d->batching = false;
+    d->stateLoaded = false;
+    return ok;
+}
+
+/**
+ * @brief run statements built at runtime as a named migration,
+ * a migration that is in the repository already is not run again.
+ * @param migration
+ * @param statements
+ * @return
+ */
+bool Migration::runStatements(const QString &migration, const QStringList &statements)
+{
+    Q_D(Migration);
+    if(!d->connection.isValid())
+    {
+        qWarning(lcMigration) << "Invalid connection.";
+        return false;
+    }
+
+    if(!d->connection.isOpen())
+        d->connection.open();
+
+    // initialize migration repository
+    this->createRepository();
+    if(d->migrations().contains(migration))
+        return true;
+
+    bool transacted = d->connection.driver()->hasFeature(QSqlDriver::Transactions);
+    if(transacted)
+        d->connection.transaction();
+
+    QSqlQuery query(d->connection);
+    foreach(const QString &cmd, statements)
+    {
+        if(!QueryProfiler::exec(query, cmd, "migration"))
+        {
+            qCritical(lcMigration) << "Migration up error '" << migration << "' " << query.lastError().text();
+            qCritical(lcMigration) << cmd;
+            if(transacted)
+                d->connection.rollback();
+            return false;
+        }
+    }
+
+    if(!this->toRepository(migration))
+    {
+        if(transacted)
+            d->connection.rollback();
+        return false;
+    }
+
+    if(transacted)
+        d->connection.commit();
+    return true;
+}
+
+/**
+ * @brief partial indexes on deleted_at for every table with soft delete,
+ * that is a nullable deleted_at field. the active and the trashed rows get
+ * an index each, so a scoped select does not read the rows of the other
+ * scope (see TableModel::scope). each table is the migration soft_delete_<table>.
+ * it reads the schema of every table, call it when a run migrated().
+ * @return
+ */
+bool Migration::createSoftDeleteIndexes()
+{
+    Q_D(Migration);
+    if(!d->connection.isValid())
+    {
+        qWarning(lcMigration) << "Invalid connection.";
+        return false;
+    }
+
+    if(!d->connection.isOpen())
+        d->connection.open();
+
+    QSqlDriver *driver = d->connection.driver();
+    const QString field = driver->escapeIdentifier("deleted_at", QSqlDriver::FieldName);
+    bool ok = true;
+    for (const QString &table : d->connection.tables())
+    {
+        QSqlQuery info(d->connection);
+        if(!info.exec(QString("PRAGMA table_info(%1)")
+                      .arg(driver->escapeIdentifier(table, QSqlDriver::TableName))))
+            continue;
+
+        // a NOT NULL deleted_at is a deletion log, not a soft delete
+        bool softDelete = false;
+        while (info.next())
+        {
+            if(info.value("name").toString() == "deleted_at")
+                softDelete = !info.value("notnull").toBool();
+        }
+        if(!softDelete)
+            continue;
+
+        const QStringList statements = {
+            IndexAdvisor::createStatement(d->connection, table, { "deleted_at" }, field + " IS NULL"),
+            IndexAdvisor::createStatement(d->connection, table, { "deleted_at" }, field + " IS NOT NULL"),
+            "ANALYZE " + driver->escapeIdentifier(table, QSqlDriver::TableName)
+        };
+        if(!this->runStatements("soft_delete_" + table, statements))
+            ok = false;
+    }
+
+    return ok;
 }
 
 /**
@@ -376,25 +725,46 @@ QString Migration::table() const
 bool Migration::migrateUp(const QString &file)
 {
     Q_D(Migration);
-    const QStringList statements = d->resolveStatements(file);
-    bool transacted = d->connection.driver()->hasFeature(QSqlDriver::Transactions);
+    QFile sqlFile(file);
+    if(!sqlFile.open(QIODevice::ReadOnly))
+    {
+        qCritical(lcMigration) << "Can not open file '" << file << "' " << sqlFile.errorString();
+        return false;
+    }
+
+    // in a single transaction batch the savepoint of the file stands in
+    bool transacted = !(d->batching && d->singleTransaction)
+            && d->connection.driver()->hasFeature(QSqlDriver::Transactions);
 
     if(transacted)
         d->connection.transaction();
 
+    // statements are executed as they are read, large data files run in constant memory
     QSqlQuery query(d->connection);
-    foreach(const QString &cmd, statements)
+    SqlStatementReader reader(&sqlFile);
+    while (reader.next())
     {
-        query.exec(cmd);
-        if(query.lastError().type() != QSqlError::NoError)
+        const QString cmd = reader.statement();
+        if(!QueryProfiler::exec(query, cmd, "migration"))
         {
-            qCritical(lcMigration) << "Migration up error '" << file << "' " << d->connection.lastError().text();
-            qCritical(lcMigration) << cmd;
+            qCritical(lcMigration) << "Migration up error '" << file << "' line" << reader.lineNumber()
+                                   << query.lastError().text();
+            qCritical(lcMigration) << cmd.left(1024);
             if(transacted)
                 d->connection.rollback();
             return false;
         }
+        query.finish();
     }
+
+    if(reader.hasError())
+    {
+        qCritical(lcMigration) << "Can not read file '" << file << "' " << reader.errorString();
+        if(transacted)
+            d->connection.rollback();
+        return false;
+    }
+
     if(transacted)
         d->connection.commit();
 
@@ -439,13 +809,28 @@ bool Migration::migrateDown(const QString &file)
 }
 
 /**
- * @brief start migration
+ * @brief start migration, the pending files are one batch.
+ * with singleTransaction the batch commits once, each file in a savepoint:
+ * a failing file is rolled back and the files before it are kept,
+ * a failing optional file is skipped.
  * @param files
  * @return
  */
 bool Migration::runMigration(const QStringList &files)
 {
     Q_D(Migration);
+    d->loadState();
+    d->lastBatch = this->lastBatchNumber() + 1;
+    d->batching = true;
+
+    const bool transacted = d->singleTransaction
+            && d->connection.driver()->hasFeature(QSqlDriver::Transactions);
+    if(transacted)
+        d->connection.transaction();
+
+    QSqlQuery savepoint(d->connection);
+    bool ok = true;
+    int count = 0;
     foreach(const QString &file, files)
     {
         // check file has been migrated
@@ -453,17 +838,60 @@ bool Migration::runMigration(const QStringList &files)
         if(d->migrationExists(name))
             continue;
 
+        const QString point = QString("migration_%1").arg(count);
+        if(transacted)
+            savepoint.exec("SAVEPOINT " + point);
+
         if(!this->migrateUp(file))
         {
-            return false;
+            if(transacted)
+            {
+                savepoint.exec("ROLLBACK TO " + point);
+                savepoint.exec("RELEASE " + point);
+            }
+            if(d->optional.contains(name))
+            {
+                qWarning(lcMigration) << "Optional migration skipped:" << name;
+                ++count;
+                continue;
+            }
+            ok = false;
+            break;
         }
 
         if(!this->toRepository(name))
-            continue;
+        {
+            // without a transaction the schema changed anyway
+            if(!transacted)
+            {
+                d->migrated = true;
+                continue;
+            }
+
+            savepoint.exec("ROLLBACK TO " + point);
+            savepoint.exec("RELEASE " + point);
+            ok = false;
+            break;
+        }
+
+        if(transacted)
+            savepoint.exec("RELEASE " + point);
+        d->migrated = true;
+        ++count;
     }
+
+    if(transacted && !d->connection.commit())
+    {
+        qCritical(lcMigration) << "Migration commit error" << d->connection.lastError().text();
+        d->connection.rollback();
+        ok = false;
+    }
+
+    d->batching = false;
+    d->stateLoaded = false;
     d->files.clear();
 
-    return true;
+    return ok;
 }
 
 /**
@@ -495,26 +923,32 @@ bool Migration::rollbackMigration(const QStringList &migrations, const QStringLi
 }
 
 /**
- * @brief save file name to migration repository
+ * @brief save file name to migration repository, with the sha256 of the
+ * script when it is known (see run(const MigrationBundle &))
  * @param migration
+ * @param hash
  * @return bool
  */
-bool Migration::toRepository(const QString &migration)
+bool Migration::toRepository(const QString &migration, const QByteArray &hash)
 {
     Q_D(Migration);
-    d->lastBatch = this->lastBatchNumber() + 1;
+    if(!d->batching)
+        d->lastBatch = this->lastBatchNumber() + 1;
     // insert if dose not exist (otherwise update it 'REPLACE' )
-    QString sql = QString("INSERT INTO %1 (migration, batch) VALUES (?, ?)").arg(table());
-    QSqlQuery query(d->connection);
-    query.prepare(sql);
+    QString sql = QString("INSERT INTO %1 (migration, batch, hash) VALUES (?, ?, ?)").arg(table());
+    QSqlQuery query = StatementCache::local()->prepare(d->connection, sql);
     query.addBindValue(migration);
     query.addBindValue(d->lastBatch);
+    query.addBindValue(QString::fromLatin1(hash.toHex()));
     if(!query.exec())
     {
         qCritical(lcMigration) << "Migration error:" << query.lastError().text();
         return false;
     }
 
+    d->applied.insert(migration);
+    if(!hash.isEmpty())
+        d->hashes.insert(migration, hash);
     return true;
 }
 
@@ -527,9 +961,10 @@ bool Migration::takeRepository(const QString &migration)
 {
     Q_D(Migration);
     d->lastBatch = this->lastBatchNumber() + 1;
-    QString sql = QString("DELETE FROM %1 WHERE migration='%2'").arg(table(), migration);
-    QSqlQuery query(d->connection);
-    if(!query.exec(sql))
+    QString sql = QString("DELETE FROM %1 WHERE migration = ?").arg(table());
+    QSqlQuery query = StatementCache::local()->prepare(d->connection, sql);
+    query.addBindValue(migration);
+    if(!query.exec())
     {
         qWarning(lcMigration) << "Rollback migration waring:" << query.lastError().text();
         return false;
@@ -539,22 +974,32 @@ bool Migration::takeRepository(const QString &migration)
 }
 
 /**
- * @brief create migration repository if dose not exists, otherwise do nothing
+ * @brief create migration repository if dose not exists, a repository
+ * created before the hash column gets it added
  * @return bool
  */
 bool Migration::createRepository()
 {
     Q_D(Migration);
+    QSqlQuery query(d->connection);
     if(!this->repositoryExists())
     {
-        QSqlQuery query(d->connection);
         query.exec(QString("CREATE TABLE %1 ("
                            "id INTEGER PRIMARY KEY AUTOINCREMENT,"
                            "migration VARCHAR(255) NOT NULL DEFAULT '',"
-                           "batch INTEGER NOT NULL DEFAULT 1)").arg(table()));
+                           "batch INTEGER NOT NULL DEFAULT 1,"
+                           "hash VARCHAR(64) NOT NULL DEFAULT '')").arg(table()));
         if(d->connection.lastError().type() != QSqlError::NoError)
             return false;
     }
+    else if(!d->connection.record(table()).contains("hash"))
+    {
+        if(!query.exec(QString("ALTER TABLE %1 ADD COLUMN hash VARCHAR(64) NOT NULL DEFAULT ''").arg(table())))
+        {
+            qCritical(lcMigration) << "Migration error:" << query.lastError().text();
+            return false;
+        }
+    }
 
     return true;
 }
@@ -572,8 +1017,8 @@ bool Migration::repositoryExists()
 int Migration::lastBatchNumber()
 {
     Q_D(Migration);
-    QSqlQuery query(d->connection);
-    if(!query.exec(QString("SELECT MAX(batch) AS batch FROM %1").arg(table())))
+    QSqlQuery query = StatementCache::local()->prepare(d->connection, QString("SELECT MAX(batch) AS batch FROM %1").arg(table()));
+    if(!query.exec())
     {
         qCritical(lcMigration) << "Migration error:" << query.lastError().text();
         return 0;
@@ -582,5 +1027,24 @@ int Migration::lastBatchNumber()
     if(!query.next())
         return 0;
 
-    return query.value("batch").toInt();
+    // the statement is cached, let go of the read lock now
+    const int batch = query.value("batch").toInt();
+    query.finish();
+    return batch;
+}
+
+/**
+ * @brief the schema version of the database, see run(const MigrationBundle &)
+ * @return int
+ */
+int Migration::schemaVersion()
+{
+    Q_D(Migration);
+    QSqlQuery query = StatementCache::local()->prepare(d->connection, "PRAGMA user_version");
+    if(!query.exec() || !query.next())
+        return 0;
+
+    const int version = query.value(0).toInt();
+    query.finish();
+    return version;
 }
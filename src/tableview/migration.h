@@ -22,6 +22,7 @@
 #include <QObject>
 
 class QSqlDatabase;
+class MigrationBundle;
 class MigrationPrivate;
 class Migration
 {
@@ -34,10 +35,18 @@ public:
 
     void setConnection(const QSqlDatabase &db);
     QSqlDatabase connection() const;
+    void setSingleTransaction(bool enabled);
+    bool singleTransaction() const;
+    void setOptional(const QStringList &migrations);
+    QStringList optional() const;
+    bool migrated() const;
     QStringList files() const;
 
     virtual bool run(const QStringList &files);
     virtual bool run(const QString &path);
+    virtual bool run(const MigrationBundle &bundle);
+    virtual bool runStatements(const QString &migration, const QStringList &statements);
+    bool createSoftDeleteIndexes();
     virtual bool reset(const QStringList &files);
     virtual bool reset(const QString &path);
 
@@ -48,11 +57,12 @@ protected:
     virtual bool runMigration(const QStringList &files);
     virtual bool rollbackMigration(const QStringList &migrations, const QStringList &files);
 
-    bool toRepository(const QString &migration);
+    bool toRepository(const QString &migration, const QByteArray &hash = QByteArray());
     bool takeRepository(const QString &migration);
     bool createRepository();
     bool repositoryExists();
     int lastBatchNumber();
+    int schemaVersion();
 
 private:
     QScopedPointer<MigrationPrivate> d_ptr;
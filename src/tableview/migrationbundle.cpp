@@ -0,0 +1,166 @@
+/**
+ * QML examples - Qt5 and QML examples
+ * Copyright (c) 2019 Yuri Young<yuri.young@qq.com>
+ *
+ * This examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "migrationbundle.h"
+#include "sqlstatementreader.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDataStream>
+#include <QCryptographicHash>
+
+#include <algorithm>
+
+static const quint32 magic = 0x4D494742; // MIGB
+static const quint32 format = 1;
+
+/**
+ * @brief read a bundle, e.g. ":/migrations.bundle"
+ * @param fileName
+ * @return
+ */
+bool MigrationBundle::load(const QString &fileName)
+{
+    m_schemaVersion = 0;
+    m_migrations.clear();
+    m_error.clear();
+
+    QFile file(fileName);
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        m_error = file.errorString();
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    quint32 head = 0, version = 0, schema = 0, count = 0;
+    stream >> head >> version;
+    if(head != magic || version != format)
+    {
+        m_error = "Not a migration bundle";
+        return false;
+    }
+
+    stream >> schema >> count;
+    m_migrations.reserve(int(count));
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i)
+    {
+        Entry entry;
+        quint32 statements = 0;
+        stream >> entry.name >> entry.hash >> statements;
+        for (quint32 j = 0; j < statements && stream.status() == QDataStream::Ok; ++j)
+        {
+            QString statement;
+            stream >> statement;
+            entry.statements << statement;
+        }
+        m_migrations << entry;
+    }
+
+    if(stream.status() != QDataStream::Ok)
+    {
+        m_error = "Truncated migration bundle";
+        m_migrations.clear();
+        return false;
+    }
+
+    m_schemaVersion = int(schema);
+    return true;
+}
+
+bool MigrationBundle::isEmpty() const
+{
+    return m_migrations.isEmpty();
+}
+
+int MigrationBundle::schemaVersion() const
+{
+    return m_schemaVersion;
+}
+
+QVector<MigrationBundle::Entry> MigrationBundle::migrations() const
+{
+    return m_migrations;
+}
+
+QString MigrationBundle::errorString() const
+{
+    return m_error;
+}
+
+/**
+ * @brief compare the bundle with the scripts it was built from: the python
+ * tool splits the statements on its own, they have to come out the same as
+ * SqlStatementReader reads them, see --check-bundle
+ * @param files the migration scripts
+ * @return the differences, empty if there are none
+ */
+QStringList MigrationBundle::verify(const QStringList &files) const
+{
+    QStringList problems;
+    for (const QString &fileName : files)
+    {
+        const QString name = QFileInfo(fileName).baseName();
+        auto entry = std::find_if(m_migrations.cbegin(), m_migrations.cend(), [&name](const Entry &migration) {
+            return migration.name == name;
+        });
+        if(entry == m_migrations.cend())
+        {
+            problems << QString("%1: not in the bundle").arg(name);
+            continue;
+        }
+
+        QFile file(fileName);
+        if(!file.open(QIODevice::ReadOnly))
+        {
+            problems << QString("%1: %2").arg(name, file.errorString());
+            continue;
+        }
+
+        if(QCryptographicHash::hash(file.readAll(), QCryptographicHash::Sha256) != entry->hash)
+        {
+            problems << QString("%1: the script changed after the bundle was built").arg(name);
+            continue;
+        }
+
+        file.seek(0);
+        SqlStatementReader reader(&file);
+        int index = 0;
+        bool same = true;
+        while (same && reader.next())
+        {
+            if(index >= entry->statements.count() || entry->statements.at(index) != reader.statement())
+            {
+                problems << QString("%1: statement %2 at line %3 differs from the bundle")
+                            .arg(name).arg(index + 1).arg(reader.lineNumber());
+                same = false;
+            }
+            ++index;
+        }
+
+        if(reader.hasError())
+            problems << QString("%1: %2").arg(name, reader.errorString());
+        else if(same && index != entry->statements.count())
+            problems << QString("%1: %2 statements in the bundle, %3 in the script")
+                        .arg(name).arg(entry->statements.count()).arg(index);
+    }
+
+    return problems;
+}
@@ -0,0 +1,56 @@
+/**
+ * QML examples - Qt5 and QML examples
+ * Copyright (c) 2019 Yuri Young<yuri.young@qq.com>
+ *
+ * This examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIGRATIONBUNDLE_H
+#define MIGRATIONBUNDLE_H
+
+#include <QStringList>
+#include <QVector>
+
+/**
+ * @brief migration scripts precompiled at build time by
+ * tools/migration_bundle.py: the statements of each script, already split,
+ * a sha256 of the script, and the schema version of the bundle, the
+ * highest number prefix of the migrations.
+ */
+class MigrationBundle
+{
+public:
+    struct Entry
+    {
+        QString name;
+        QByteArray hash;
+        QStringList statements;
+    };
+
+    bool load(const QString &fileName);
+    bool isEmpty() const;
+
+    int schemaVersion() const;
+    QVector<Entry> migrations() const;
+    QString errorString() const;
+
+    QStringList verify(const QStringList &files) const;
+
+private:
+    int m_schemaVersion = 0;
+    QVector<Entry> m_migrations;
+    QString m_error;
+};
+
+#endif // MIGRATIONBUNDLE_H
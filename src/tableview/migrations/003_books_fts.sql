@@ -0,0 +1,23 @@
+CREATE VIRTUAL TABLE IF NOT EXISTS books_fts USING fts5(
+    title,
+    author,
+    description,
+    content='books',
+    content_rowid='id',
+    tokenize='trigram'
+);
+CREATE TRIGGER IF NOT EXISTS books_fts_insert AFTER INSERT ON books BEGIN
+    INSERT INTO books_fts(rowid, title, author, description)
+    VALUES (new.id, new.title, new.author, new.description);
+END;
+CREATE TRIGGER IF NOT EXISTS books_fts_delete AFTER DELETE ON books BEGIN
+    INSERT INTO books_fts(books_fts, rowid, title, author, description)
+    VALUES ('delete', old.id, old.title, old.author, old.description);
+END;
+CREATE TRIGGER IF NOT EXISTS books_fts_update AFTER UPDATE OF title, author, description ON books BEGIN
+    INSERT INTO books_fts(books_fts, rowid, title, author, description)
+    VALUES ('delete', old.id, old.title, old.author, old.description);
+    INSERT INTO books_fts(rowid, title, author, description)
+    VALUES (new.id, new.title, new.author, new.description);
+END;
+INSERT INTO books_fts(books_fts) VALUES ('rebuild');
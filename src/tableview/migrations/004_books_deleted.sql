@@ -0,0 +1,15 @@
+CREATE TABLE IF NOT EXISTS books_deleted (
+    `id` INTEGER NOT NULL,
+    `deleted_at` DATETIME NOT NULL DEFAULT (datetime('now', 'localtime'))
+);
+CREATE INDEX IF NOT EXISTS index_books_deleted_deleted_at ON books_deleted (deleted_at);
+CREATE INDEX IF NOT EXISTS index_books_updated_at ON books (updated_at);
+CREATE TRIGGER IF NOT EXISTS books_touch AFTER UPDATE ON books
+WHEN new.updated_at IS old.updated_at
+BEGIN
+    UPDATE books SET updated_at = datetime('now', 'localtime') WHERE id = new.id;
+END;
+CREATE TRIGGER IF NOT EXISTS books_log_delete AFTER DELETE ON books BEGIN
+    DELETE FROM books_deleted WHERE deleted_at < datetime('now', 'localtime', '-1 day');
+    INSERT INTO books_deleted (id) VALUES (old.id);
+END;
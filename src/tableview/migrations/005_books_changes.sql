@@ -0,0 +1,21 @@
+CREATE TABLE IF NOT EXISTS books_changes (
+    `seq` INTEGER PRIMARY KEY AUTOINCREMENT,
+    `id` INTEGER NOT NULL,
+    `deleted` BOOLEAN NOT NULL DEFAULT false
+);
+DROP TRIGGER IF EXISTS books_log_delete;
+DROP TABLE IF EXISTS books_deleted;
+CREATE TRIGGER IF NOT EXISTS books_changes_insert AFTER INSERT ON books BEGIN
+    INSERT INTO books_changes (id) VALUES (new.id);
+END;
+CREATE TRIGGER IF NOT EXISTS books_changes_update AFTER UPDATE ON books BEGIN
+    INSERT INTO books_changes (id) VALUES (new.id);
+END;
+CREATE TRIGGER IF NOT EXISTS books_changes_delete AFTER DELETE ON books BEGIN
+    INSERT INTO books_changes (id, deleted) VALUES (old.id, true);
+END;
+CREATE TRIGGER IF NOT EXISTS books_changes_prune AFTER INSERT ON books_changes
+WHEN new.seq % 1000 = 0
+BEGIN
+    DELETE FROM books_changes WHERE seq <= new.seq - 100000;
+END;
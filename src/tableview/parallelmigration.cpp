@@ -0,0 +1,204 @@
+/**
+ * QML examples - Qt5 and QML examples
+ * Copyright (c) 2019 Yuri Young<yuri.young@qq.com>
+ *
+ * This examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "parallelmigration.h"
+#include "migration.h"
+#include "statementcache.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QElapsedTimer>
+#include <QUuid>
+#include <QLoggingCategory>
+
+#include <algorithm>
+
+Q_LOGGING_CATEGORY(lcParallelMigration, "app.ParallelMigration")
+
+namespace {
+
+class MigrationTask : public QRunnable
+{
+public:
+    MigrationTask(const ParallelMigration *migration, const QString &databaseName, ParallelMigration::Result *result)
+        : m_migration(migration), m_databaseName(databaseName), m_result(result)
+    {
+    }
+
+    void run() override
+    {
+        *m_result = m_migration->migrate(m_databaseName);
+    }
+
+private:
+    const ParallelMigration *m_migration;
+    QString m_databaseName;
+    ParallelMigration::Result *m_result;
+};
+
+} // namespace
+
+ParallelMigration::ParallelMigration(const QStringList &files)
+    : m_files(files), m_maxThreads(QThread::idealThreadCount())
+{
+}
+
+ParallelMigration::ParallelMigration(const MigrationBundle &bundle)
+    : m_bundle(bundle), m_maxThreads(QThread::idealThreadCount())
+{
+}
+
+void ParallelMigration::setMaxThreads(int count)
+{
+    m_maxThreads = qMax(1, count);
+}
+
+int ParallelMigration::maxThreads() const
+{
+    return m_maxThreads;
+}
+
+/**
+ * @brief migrations whose failure does not fail a database, see Migration::setOptional()
+ * @param migrations
+ */
+void ParallelMigration::setOptional(const QStringList &migrations)
+{
+    m_optional = migrations;
+}
+
+QStringList ParallelMigration::optional() const
+{
+    return m_optional;
+}
+
+/**
+ * @brief migrate the databases and wait for all of them
+ * @param databases
+ * @return a result per database, in the order of databases
+ */
+QVector<ParallelMigration::Result> ParallelMigration::run(const QStringList &databases) const
+{
+    QVector<Result> results(databases.count());
+    QThreadPool pool;
+    pool.setMaxThreadCount(m_maxThreads);
+    for (int i = 0; i < databases.count(); ++i)
+        pool.start(new MigrationTask(this, databases.at(i), &results[i]));
+
+    pool.waitForDone();
+    return results;
+}
+
+/**
+ * @brief migrate one database on the calling thread
+ * @param databaseName
+ * @return
+ */
+ParallelMigration::Result ParallelMigration::migrate(const QString &databaseName) const
+{
+    Result result;
+    result.databaseName = databaseName;
+    QElapsedTimer clock;
+    clock.start();
+
+    const QString connectionName = QUuid::createUuid().toString(QUuid::Id128);
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+        db.setDatabaseName(databaseName);
+        if(!db.open())
+        {
+            result.error = db.lastError().text();
+        }
+        else
+        {
+            QSqlQuery(db).exec("PRAGMA busy_timeout = 5000");
+
+            Migration migration(db);
+            migration.setSingleTransaction(true);
+            migration.setOptional(m_optional);
+            result.ok = m_bundle.isEmpty() ? migration.run(m_files) : migration.run(m_bundle);
+            if(result.ok && migration.migrated())
+                result.ok = migration.createSoftDeleteIndexes();
+            if(!result.ok)
+                result.error = "Migration failed";
+
+            StatementCache::local()->invalidate(db);
+        }
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(connectionName);
+
+    result.elapsed = clock.elapsed();
+    if(!result.ok)
+        qWarning(lcParallelMigration) << databaseName << result.error;
+
+    return result;
+}
+
+/**
+ * @brief the database files matching a wildcard pattern, e.g. tenants/*.db
+ * @param pattern
+ * @return
+ */
+QStringList ParallelMigration::databases(const QString &pattern)
+{
+    const QFileInfo info(pattern);
+    QDir dir = info.dir();
+    QStringList databases;
+    const QStringList names = dir.entryList({ info.fileName() }, QDir::Files, QDir::Name);
+    for (const QString &name : names)
+        databases << dir.filePath(name);
+
+    return databases;
+}
+
+QString ParallelMigration::report(const QVector<Result> &results, qint64 elapsed)
+{
+    int failed = 0;
+    qint64 total = 0;
+    QVector<Result> slowest = results;
+    for (const Result &result : results)
+    {
+        failed += result.ok ? 0 : 1;
+        total += result.elapsed;
+    }
+
+    std::sort(slowest.begin(), slowest.end(), [](const Result &a, const Result &b) {
+        return a.elapsed > b.elapsed;
+    });
+
+    QString text = QString("%1 databases, %2 failed, %3 ms (%4 ms of work)\n")
+            .arg(results.count()).arg(failed).arg(elapsed).arg(total);
+
+    for (const Result &result : results)
+    {
+        if(!result.ok)
+            text += QString("failed  %1: %2\n").arg(result.databaseName, result.error);
+    }
+
+    for (int i = 0; i < qMin(5, slowest.count()); ++i)
+        text += QString("slowest %1: %2 ms\n").arg(slowest.at(i).databaseName).arg(slowest.at(i).elapsed);
+
+    return text;
+}
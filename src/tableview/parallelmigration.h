@@ -0,0 +1,64 @@
+/**
+ * QML examples - Qt5 and QML examples
+ * Copyright (c) 2019 Yuri Young<yuri.young@qq.com>
+ *
+ * This examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PARALLELMIGRATION_H
+#define PARALLELMIGRATION_H
+
+#include <QStringList>
+#include <QVector>
+
+#include "migrationbundle.h"
+
+/**
+ * @brief migrates many database files at once, one per pool thread.
+ * each database gets a connection of its own for the time of its
+ * migration, the databases do not wait for each other.
+ */
+class ParallelMigration
+{
+public:
+    struct Result
+    {
+        QString databaseName;
+        bool ok = false;
+        qint64 elapsed = 0;     // milliseconds
+        QString error;
+    };
+
+    explicit ParallelMigration(const QStringList &files);
+    explicit ParallelMigration(const MigrationBundle &bundle);
+
+    void setMaxThreads(int count);
+    int maxThreads() const;
+    void setOptional(const QStringList &migrations);
+    QStringList optional() const;
+
+    QVector<Result> run(const QStringList &databases) const;
+    Result migrate(const QString &databaseName) const;
+
+    static QStringList databases(const QString &pattern);
+    static QString report(const QVector<Result> &results, qint64 elapsed);
+
+private:
+    QStringList m_files;
+    MigrationBundle m_bundle;
+    QStringList m_optional;
+    int m_maxThreads;
+};
+
+#endif // PARALLELMIGRATION_H
@@ -0,0 +1,408 @@
+/**
+ * QML examples - Qt5 and QML examples
+ * Copyright (c) 2019 Yuri Young<yuri.young@qq.com>
+ *
+ * This examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "queryprofiler.h"
+#include "statementcache.h"
+#include "connectionpool.h"
+
+#include <QCoreApplication>
+#include <QThread>
+#include <QFile>
+#include <QSqlQuery>
+#include <QSqlDriver>
+#include <QSqlResult>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QJsonDocument>
+#include <QLoggingCategory>
+
+#include <algorithm>
+
+Q_LOGGING_CATEGORY(lcQueryProfiler, "app.QueryProfiler")
+
+// distinct statements summed up and explained
+static const int maxStatements = 1024;
+
+QueryProfiler::QueryProfiler(QObject *parent)
+    : QObject(parent)
+{
+    m_clock.start();
+}
+
+QueryProfiler *QueryProfiler::instance()
+{
+    static QueryProfiler profiler;
+    return &profiler;
+}
+
+/**
+ * @brief execute a prepared query and record it
+ * @param query
+ * @param category where the statement comes from, e.g. "migration"
+ * @return the result of QSqlQuery::exec()
+ */
+bool QueryProfiler::exec(QSqlQuery &query, const char *category)
+{
+    QueryProfiler *profiler = instance();
+    if(!profiler->isEnabled())
+        return query.exec();
+
+    const qint64 start = profiler->now();
+    const bool ok = query.exec();
+    profiler->record(category, query.lastQuery(), start,
+                     query.isSelect() ? -1 : query.numRowsAffected(), ok, &query);
+    return ok;
+}
+
+bool QueryProfiler::exec(QSqlQuery &query, const QString &statement, const char *category)
+{
+    QueryProfiler *profiler = instance();
+    if(!profiler->isEnabled())
+        return query.exec(statement);
+
+    const qint64 start = profiler->now();
+    const bool ok = query.exec(statement);
+    profiler->record(category, statement, start,
+                     query.isSelect() ? -1 : query.numRowsAffected(), ok, &query);
+    return ok;
+}
+
+void QueryProfiler::setEnabled(bool enabled)
+{
+    if(isEnabled() == enabled)
+        return;
+
+    m_enabled.storeRelease(enabled ? 1 : 0);
+    emit enabledChanged();
+}
+
+bool QueryProfiler::isEnabled() const
+{
+    return m_enabled.loadAcquire() != 0;
+}
+
+/**
+ * @brief explain each statement the first time it is recorded
+ * @param enabled
+ */
+void QueryProfiler::setExplain(bool enabled)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        if(m_explain == enabled)
+            return;
+        m_explain = enabled;
+    }
+    emit explainChanged();
+}
+
+bool QueryProfiler::explain() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_explain;
+}
+
+/**
+ * @brief records kept for the trace, older ones are dropped
+ * @param count
+ */
+void QueryProfiler::setMaxRecords(int count)
+{
+    QVector<Record> records = this->records();
+    QMutexLocker locker(&m_mutex);
+    m_maxRecords = qMax(1, count);
+    if(records.count() > m_maxRecords)
+        records.remove(0, records.count() - m_maxRecords);
+    m_records = records;
+    m_next = 0;
+}
+
+int QueryProfiler::maxRecords() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_maxRecords;
+}
+
+/**
+ * @brief microseconds since the profiler started
+ * @return
+ */
+qint64 QueryProfiler::now() const
+{
+    return m_clock.nsecsElapsed() / 1000;
+}
+
+/**
+ * @brief record a statement that started at start and ends now
+ * @param category
+ * @param statement
+ * @param start see now()
+ * @param rows rows affected, -1 if not known
+ * @param ok
+ * @param query the executed query, to explain the statement with its values
+ */
+void QueryProfiler::record(const char *category, const QString &statement, qint64 start, int rows, bool ok,
+                           const QSqlQuery *query)
+{
+    Record record;
+    record.duration = now() - start;
+    record.start = start;
+    record.category = QString::fromLatin1(category);
+    record.statement = statement;
+    record.rows = rows;
+    record.ok = ok;
+    record.thread = quintptr(QThread::currentThreadId());
+
+    bool explained = false;
+    {
+        QMutexLocker locker(&m_mutex);
+        explained = !m_explain || m_plans.contains(statement) || m_plans.count() >= maxStatements;
+    }
+
+    if(!explained && query && ok)
+    {
+        bool scan = false;
+        const QString plan = explainPlan(*query, &scan);
+        QMutexLocker locker(&m_mutex);
+        m_plans.insert(statement, plan);
+        m_scans.insert(statement, scan);
+        if(scan)
+            qDebug(lcQueryProfiler) << "full table scan:" << statement << plan;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    record.scan = m_scans.value(statement);
+    if(m_records.count() < m_maxRecords)
+    {
+        m_records << record;
+    }
+    else
+    {
+        m_records[m_next] = record;
+        m_next = (m_next + 1) % m_maxRecords;
+    }
+
+    if(m_summaries.contains(statement) || m_summaries.count() < maxStatements)
+    {
+        Summary &summary = m_summaries[statement];
+        summary.category = record.category;
+        ++summary.count;
+        summary.total += record.duration;
+        summary.max = qMax(summary.max, record.duration);
+        if(rows > 0)
+            summary.rows += rows;
+    }
+}
+
+/**
+ * @brief the records, oldest first
+ * @return
+ */
+QVector<QueryProfiler::Record> QueryProfiler::records() const
+{
+    QMutexLocker locker(&m_mutex);
+    QVector<Record> records;
+    records.reserve(m_records.count());
+    for (int i = 0; i < m_records.count(); ++i)
+        records << m_records.at((m_next + i) % m_records.count());
+    return records;
+}
+
+/**
+ * @brief the EXPLAIN QUERY PLAN lines of a recorded statement
+ * @param statement
+ * @return
+ */
+QString QueryProfiler::plan(const QString &statement) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_plans.value(statement);
+}
+
+/**
+ * @brief the recorded statements summed up, for QML
+ * @param top the number of slowest statements listed
+ * @return { statements, time, scans, slowest: [...], fullScans: [...],
+ * statementCache: {...}, connections: {...} }, times in milliseconds
+ */
+QVariantMap QueryProfiler::stats(int top) const
+{
+    struct Entry
+    {
+        QString statement;
+        Summary summary;
+    };
+
+    QVector<Entry> entries;
+    QVariantList scans;
+    int statements = 0;
+    qint64 time = 0;
+    {
+        QMutexLocker locker(&m_mutex);
+        for (auto it = m_summaries.constBegin(); it != m_summaries.constEnd(); ++it)
+        {
+            entries << Entry{ it.key(), it.value() };
+            statements += it->count;
+            time += it->total;
+            if(m_scans.value(it.key()))
+                scans << it.key();
+        }
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+        return a.summary.total > b.summary.total;
+    });
+
+    QVariantList slowest;
+    for (int i = 0; i < qMin(top, entries.count()); ++i)
+    {
+        const Entry &entry = entries.at(i);
+        QVariantMap item;
+        item["statement"] = entry.statement;
+        item["category"] = entry.summary.category;
+        item["count"] = entry.summary.count;
+        item["total"] = entry.summary.total / 1000.0;
+        item["max"] = entry.summary.max / 1000.0;
+        item["average"] = entry.summary.total / 1000.0 / entry.summary.count;
+        item["rows"] = entry.summary.rows;
+        item["plan"] = plan(entry.statement);
+        item["scan"] = scans.contains(entry.statement);
+        slowest << item;
+    }
+
+    StatementCache *cache = StatementCache::local();
+    QVariantMap statementCache;
+    statementCache["count"] = cache->count();
+    statementCache["hits"] = cache->hits();
+    statementCache["prepares"] = cache->prepares();
+
+    const ConnectionPool::Metrics metrics = ConnectionPool::instance()->metrics();
+    QVariantMap connections;
+    connections["connections"] = metrics.connections;
+    connections["busy"] = metrics.busy;
+    connections["checkouts"] = metrics.checkouts;
+    connections["waits"] = metrics.waits;
+    connections["timeouts"] = metrics.timeouts;
+    connections["waitTime"] = metrics.waitTime;
+
+    QVariantMap stats;
+    stats["enabled"] = isEnabled();
+    stats["statements"] = statements;
+    stats["time"] = time / 1000.0;
+    stats["scans"] = scans.count();
+    stats["slowest"] = slowest;
+    stats["fullScans"] = scans;
+    stats["statementCache"] = statementCache;
+    stats["connections"] = connections;
+    return stats;
+}
+
+/**
+ * @brief write the records in the Chrome trace event format
+ * @param fileName
+ * @return
+ */
+bool QueryProfiler::writeTrace(const QString &fileName) const
+{
+    const qint64 pid = QCoreApplication::applicationPid();
+    QJsonArray events;
+    for (const Record &record : records())
+    {
+        QJsonObject args;
+        args["sql"] = record.statement;
+        args["rows"] = record.rows;
+        args["ok"] = record.ok;
+        args["scan"] = record.scan;
+        const QString plan = this->plan(record.statement);
+        if(!plan.isEmpty())
+            args["plan"] = plan;
+
+        QJsonObject event;
+        event["name"] = record.statement.simplified().left(80);
+        event["cat"] = record.category;
+        event["ph"] = "X";
+        event["ts"] = record.start;
+        event["dur"] = record.duration;
+        event["pid"] = pid;
+        event["tid"] = qint64(record.thread);
+        event["args"] = args;
+        events << event;
+    }
+
+    QJsonObject trace;
+    trace["traceEvents"] = events;
+    trace["displayTimeUnit"] = "ms";
+
+    QFile file(fileName);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        qWarning(lcQueryProfiler) << "Can not write trace" << fileName << file.errorString();
+        return false;
+    }
+
+    file.write(QJsonDocument(trace).toJson(QJsonDocument::Compact));
+    return true;
+}
+
+void QueryProfiler::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_records.clear();
+    m_next = 0;
+    m_summaries.clear();
+}
+
+/**
+ * @brief EXPLAIN QUERY PLAN of a query with its bound values,
+ * on the connection of the query
+ * @param query
+ * @param scan set if a table is read from start to end
+ * @return the detail of each step, one per line
+ */
+QString QueryProfiler::explainPlan(const QSqlQuery &query, bool *scan) const
+{
+    const QString statement = query.lastQuery().trimmed();
+    const QString head = statement.left(8).toUpper();
+    if(!head.startsWith("SELECT") && !head.startsWith("INSERT") && !head.startsWith("UPDATE")
+            && !head.startsWith("DELETE") && !head.startsWith("WITH") && !head.startsWith("REPLACE"))
+        return QString();
+
+    QSqlQuery explain(query.driver()->createResult());
+    explain.setForwardOnly(true);
+    if(!explain.prepare("EXPLAIN QUERY PLAN " + statement))
+        return QString();
+
+    const int count = query.boundValues().size();
+    for (int i = 0; i < count; ++i)
+        explain.bindValue(i, query.boundValue(i));
+
+    if(!explain.exec())
+        return QString();
+
+    QStringList lines;
+    while (explain.next())
+    {
+        // id, parent, notused, detail
+        const QString detail = explain.value(3).toString();
+        lines << detail;
+        if(detail.startsWith("SCAN ") && !detail.contains("INDEX") && !detail.contains("CONSTANT ROW"))
+            *scan = true;
+    }
+
+    return lines.join('\n');
+}
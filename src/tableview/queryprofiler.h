@@ -0,0 +1,111 @@
+/**
+ * QML examples - Qt5 and QML examples
+ * Copyright (c) 2019 Yuri Young<yuri.young@qq.com>
+ *
+ * This examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef QUERYPROFILER_H
+#define QUERYPROFILER_H
+
+#include <QObject>
+#include <QMutex>
+#include <QHash>
+#include <QVector>
+#include <QVariantMap>
+#include <QElapsedTimer>
+
+class QSqlQuery;
+
+/**
+ * @brief records the statements of migrations and models while enabled:
+ * wall time, rows affected and the EXPLAIN QUERY PLAN of each statement,
+ * flagging plans that scan a whole table. the records can be written as a
+ * Chrome trace (chrome://tracing, Perfetto), and stats() sums them up for
+ * QML, see the Profiler singleton.
+ * disabled, exec() only executes the query.
+ */
+class QueryProfiler : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(bool enabled READ isEnabled WRITE setEnabled NOTIFY enabledChanged)
+    Q_PROPERTY(bool explain READ explain WRITE setExplain NOTIFY explainChanged)
+public:
+    struct Record
+    {
+        QString category;
+        QString statement;
+        qint64 start = 0;       // microseconds since the profiler started
+        qint64 duration = 0;    // microseconds
+        int rows = -1;          // rows affected, -1 for queries
+        quintptr thread = 0;
+        bool scan = false;
+        bool ok = true;
+    };
+
+    static QueryProfiler *instance();
+
+    static bool exec(QSqlQuery &query, const char *category);
+    static bool exec(QSqlQuery &query, const QString &statement, const char *category);
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const;
+
+    void setExplain(bool enabled);
+    bool explain() const;
+
+    void setMaxRecords(int count);
+    int maxRecords() const;
+
+    qint64 now() const;
+    void record(const char *category, const QString &statement, qint64 start, int rows, bool ok,
+                const QSqlQuery *query = nullptr);
+
+    QVector<Record> records() const;
+    QString plan(const QString &statement) const;
+
+    Q_INVOKABLE QVariantMap stats(int top = 10) const;
+    Q_INVOKABLE bool writeTrace(const QString &fileName) const;
+    Q_INVOKABLE void clear();
+
+signals:
+    void enabledChanged();
+    void explainChanged();
+
+private:
+    struct Summary
+    {
+        QString category;
+        int count = 0;
+        qint64 total = 0;
+        qint64 max = 0;
+        qint64 rows = 0;
+    };
+
+    explicit QueryProfiler(QObject *parent = nullptr);
+    QString explainPlan(const QSqlQuery &query, bool *scan) const;
+
+    mutable QMutex m_mutex;
+    QElapsedTimer m_clock;
+    QAtomicInt m_enabled;
+    bool m_explain = true;
+    int m_maxRecords = 100000;
+    QVector<Record> m_records;  // a ring of maxRecords
+    int m_next = 0;
+    QHash<QString, Summary> m_summaries;
+    QHash<QString, QString> m_plans;
+    QHash<QString, bool> m_scans;
+};
+
+#endif // QUERYPROFILER_H
@@ -0,0 +1,365 @@
+/**
+ * QML examples - Qt5 and QML examples
+ * Copyright (c) 2019 Yuri Young<yuri.young@qq.com>
+ *
+ * This examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "relationcache.h"
+#include "migration.h"
+#include "sql.h"
+
+#include <QSqlDriver>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QCryptographicHash>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QLoggingCategory>
+
+Q_LOGGING_CATEGORY(lcRelationCache, "app.RelationCache")
+
+namespace {
+
+/**
+ * @brief creates the triggers that count the changes of a lookup table,
+ * on a write connection of the pool like IndexAdvisor does its indexes
+ */
+class TrackTask : public QRunnable
+{
+public:
+    TrackTask(const QString &databaseName, const QString &table)
+        : m_databaseName(databaseName), m_table(table)
+    {
+    }
+
+    void run() override
+    {
+        PooledConnection connection(m_databaseName, ConnectionPool::WriteMode);
+        QSqlDatabase db = connection.database();
+        if(!db.isOpen())
+        {
+            qWarning(lcRelationCache) << "Can not open database" << db.lastError().text();
+            return;
+        }
+
+        QSqlDriver *driver = db.driver();
+        const QString table = driver->escapeIdentifier(m_table, QSqlDriver::TableName);
+        QString name = m_table;
+        name.replace('\'', "''");
+        const QString bump = QString("UPDATE relation_versions SET version = version + 1 WHERE name = '%1';").arg(name);
+
+        QStringList statements = {
+            "CREATE TABLE IF NOT EXISTS relation_versions ("
+            "name VARCHAR(255) PRIMARY KEY, version INTEGER NOT NULL DEFAULT 0)",
+            QString("INSERT OR IGNORE INTO relation_versions (name) VALUES ('%1')").arg(name)
+        };
+        for (const QString &event : { QString("INSERT"), QString("UPDATE"), QString("DELETE") })
+        {
+            const QString trigger = driver->escapeIdentifier(QString("relation_version_%1_%2").arg(m_table, event.toLower()),
+                                                             QSqlDriver::TableName);
+            statements << QString("CREATE TRIGGER IF NOT EXISTS %1 AFTER %2 ON %3 BEGIN %4 END")
+                          .arg(trigger, event, table, bump);
+        }
+
+        Migration migration(db);
+        if(migration.runStatements("relation_version_" + m_table, statements))
+            qDebug(lcRelationCache) << "tracking lookup table" << m_table;
+    }
+
+private:
+    QString m_databaseName;
+    QString m_table;
+};
+
+} // namespace
+
+void RelationCache::setRelation(int column, const Relation &relation)
+{
+    m_relations.insert(column, relation);
+}
+
+void RelationCache::removeRelation(int column)
+{
+    m_relations.remove(column);
+}
+
+bool RelationCache::hasRelation(int column) const
+{
+    return m_relations.contains(column);
+}
+
+RelationCache::Relation RelationCache::relation(int column) const
+{
+    return m_relations.value(column);
+}
+
+QList<int> RelationCache::columns() const
+{
+    return m_relations.keys();
+}
+
+/**
+ * @brief install triggers counting the changes of each lookup table,
+ * so a commit only reads the lookup tables it changed again.
+ * the triggers and relation_versions stay in the database.
+ * @param enabled
+ */
+void RelationCache::setTracking(bool enabled)
+{
+    m_tracking = enabled;
+}
+
+bool RelationCache::tracking() const
+{
+    return m_tracking;
+}
+
+void RelationCache::clear()
+{
+    m_relations.clear();
+    m_lookups.clear();
+    m_tracked.clear();
+}
+
+/**
+ * @brief the display text of a key, the lookup table is read on first use
+ * @param db
+ * @param column
+ * @param key
+ * @return the key itself if the lookup table does not have it
+ */
+QVariant RelationCache::display(const QSqlDatabase &db, int column, const QVariant &key)
+{
+    if(key.isNull())
+        return key;
+
+    const Lookup *lookup = this->lookup(db, column);
+    if(!lookup)
+        return key;
+
+    auto it = lookup->values.constFind(key.toString());
+    return it == lookup->values.constEnd() ? key : QVariant(*it);
+}
+
+/**
+ * @brief the rows of the lookup table, for an editor
+ * @param db
+ * @param column
+ * @return [{ value: key, text: display text }] ordered by text
+ */
+QVariantList RelationCache::choices(const QSqlDatabase &db, int column)
+{
+    QVariantList choices;
+    const Lookup *lookup = this->lookup(db, column);
+    if(!lookup)
+        return choices;
+
+    choices.reserve(lookup->keys.count());
+    for (const QString &key : lookup->keys)
+    {
+        QVariantMap choice;
+        choice["value"] = key;
+        choice["text"] = lookup->values.value(key);
+        choices << choice;
+    }
+
+    return choices;
+}
+
+/**
+ * @brief read the loaded lookup tables again if the database changed since
+ * the last check, through another connection (data_version) or this one
+ * (total_changes()). both are cheap to ask for. then only the lookup tables
+ * whose version in relation_versions moved are read, a table that is not
+ * tracked yet is read and compared by its hash.
+ * @param db
+ * @return the columns whose lookup table changed
+ */
+QList<int> RelationCache::validate(const QSqlDatabase &db)
+{
+    QList<int> changed;
+    if(m_lookups.isEmpty())
+        return changed;
+
+    QSqlQuery version = Sql::statement("PRAGMA data_version", db);
+    if(!version.exec() || !version.next())
+        return changed;
+    const qint64 dataVersion = version.value(0).toLongLong();
+    version.finish();
+
+    QSqlQuery changes = Sql::statement("SELECT total_changes()", db);
+    if(!changes.exec() || !changes.next())
+        return changed;
+    const qint64 totalChanges = changes.value(0).toLongLong();
+    changes.finish();
+
+    if(dataVersion == m_dataVersion && totalChanges == m_changes)
+        return changed;
+
+    m_dataVersion = dataVersion;
+    m_changes = totalChanges;
+
+    const QHash<QString, qint64> versions = RelationCache::versions(db);
+    QSet<QString> reloaded;
+    QSet<QString> unchanged;
+    for (auto it = m_relations.constBegin(); it != m_relations.constEnd(); ++it)
+    {
+        const QString key = id(it.value());
+        auto lookup = m_lookups.find(key);
+        if(lookup == m_lookups.end() || !lookup->loaded || unchanged.contains(key))
+            continue;
+
+        if(!reloaded.contains(key))
+        {
+            const qint64 version = versions.value(it->table, -1);
+            if(version >= 0 && version == lookup->version)
+            {
+                unchanged.insert(key);
+                continue;
+            }
+            lookup->version = version;
+
+            Lookup fresh;
+            fresh.version = version;
+            if(!load(db, it.value(), &fresh) || fresh.signature == lookup->signature)
+            {
+                unchanged.insert(key);
+                continue;
+            }
+
+            *lookup = fresh;
+            reloaded.insert(key);
+            qDebug(lcRelationCache) << "lookup table changed:" << it->table;
+        }
+        changed << it.key();
+    }
+
+    return changed;
+}
+
+QString RelationCache::id(const Relation &relation)
+{
+    return relation.table + '\n' + relation.keyField + '\n' + relation.displayFields.join(',');
+}
+
+/**
+ * @brief the change count of each tracked lookup table, one small read.
+ * relation_versions exists once the first TrackTask ran, the statement
+ * is cached after it read once, a failed prepare is no warning before.
+ * @param db
+ * @return empty if no table is tracked yet
+ */
+QHash<QString, qint64> RelationCache::versions(const QSqlDatabase &db)
+{
+    const QString statement = "SELECT name, version FROM relation_versions";
+    QHash<QString, qint64> versions;
+    QSqlQuery query(db);
+    bool ok = false;
+    if(m_versioned)
+    {
+        query = Sql::statement(statement, db);
+        ok = query.exec();
+    }
+    else
+    {
+        ok = query.exec(statement);
+    }
+    if(!ok)
+        return versions;
+
+    m_versioned = true;
+    while (query.next())
+        versions.insert(query.value(0).toString(), query.value(1).toLongLong());
+    query.finish();
+    return versions;
+}
+
+/**
+ * @brief have the changes of a lookup table counted, once per table,
+ * if tracking is on
+ * @param db
+ * @param table
+ */
+void RelationCache::track(const QSqlDatabase &db, const QString &table)
+{
+    if(!m_tracking || m_tracked.contains(table) || db.databaseName().isEmpty())
+        return;
+
+    m_tracked.insert(table);
+    QThreadPool::globalInstance()->start(new TrackTask(db.databaseName(), table));
+}
+
+bool RelationCache::load(const QSqlDatabase &db, const Relation &relation, Lookup *lookup) const
+{
+    QSqlDriver *driver = db.driver();
+    QStringList display;
+    for (const QString &field : relation.displayFields)
+        display << driver->escapeIdentifier(field, QSqlDriver::FieldName);
+
+    const QString statement = QString("SELECT %1, %2 FROM %3 ORDER BY %2")
+            .arg(driver->escapeIdentifier(relation.keyField, QSqlDriver::FieldName),
+                 display.join(", "),
+                 driver->escapeIdentifier(relation.table, QSqlDriver::TableName));
+
+    QSqlQuery query = Sql::statement(statement, db);
+    if(!query.exec())
+    {
+        qWarning(lcRelationCache) << "Read lookup table error" << relation.table << query.lastError().text();
+        return false;
+    }
+
+    QCryptographicHash signature(QCryptographicHash::Md5);
+    while (query.next())
+    {
+        const QString key = query.value(0).toString();
+        QStringList texts;
+        for (int i = 1; i <= display.count(); ++i)
+        {
+            const QString text = query.value(i).toString();
+            if(!text.isEmpty())
+                texts << text;
+        }
+        const QString text = texts.join(' ');
+
+        lookup->values.insert(key, text);
+        lookup->keys << key;
+        signature.addData((key + '\x1f' + text + '\x1e').toUtf8());
+    }
+    query.finish();
+
+    lookup->signature = signature.result();
+    lookup->loaded = true;
+    return true;
+}
+
+RelationCache::Lookup *RelationCache::lookup(const QSqlDatabase &db, int column)
+{
+    auto relation = m_relations.constFind(column);
+    if(relation == m_relations.constEnd())
+        return nullptr;
+
+    Lookup &lookup = m_lookups[id(*relation)];
+    if(!lookup.loaded)
+    {
+        // the version is read first, a change during the read is not lost
+        lookup.version = versions(db).value(relation->table, -1);
+        // a failed read is not tried again for every cell
+        load(db, *relation, &lookup);
+        lookup.loaded = true;
+        track(db, relation->table);
+    }
+
+    return &lookup;
+}
@@ -0,0 +1,88 @@
+/**
+ * QML examples - Qt5 and QML examples
+ * Copyright (c) 2019 Yuri Young<yuri.young@qq.com>
+ *
+ * This examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RELATIONCACHE_H
+#define RELATIONCACHE_H
+
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+#include <QVariant>
+#include <QVector>
+
+class QSqlDatabase;
+
+/**
+ * @brief the lookup tables of foreign key columns held in memory.
+ * a lookup table is read once into a hash of key to display text, and
+ * read again after a commit on the database and replaced only if its
+ * content changed, which a hash of the rows tells. with tracking turned on
+ * triggers on the lookup table count its changes in relation_versions and
+ * only the changed tables are read again, see track() and validate().
+ * tracking changes the schema of the database, it is off by default.
+ */
+class RelationCache
+{
+public:
+    struct Relation
+    {
+        QString table;
+        QString keyField;
+        QStringList displayFields;  // joined by a space
+    };
+
+    void setRelation(int column, const Relation &relation);
+    void removeRelation(int column);
+    bool hasRelation(int column) const;
+    Relation relation(int column) const;
+    QList<int> columns() const;
+    void clear();
+
+    void setTracking(bool enabled);
+    bool tracking() const;
+
+    QVariant display(const QSqlDatabase &db, int column, const QVariant &key);
+    QVariantList choices(const QSqlDatabase &db, int column);
+    QList<int> validate(const QSqlDatabase &db);
+
+private:
+    struct Lookup
+    {
+        QHash<QString, QString> values;
+        QVector<QString> keys;      // ordered by display text
+        QByteArray signature;
+        qint64 version = -1;        // of relation_versions, -1 if not known
+        bool loaded = false;
+    };
+
+    static QString id(const Relation &relation);
+    QHash<QString, qint64> versions(const QSqlDatabase &db);
+    void track(const QSqlDatabase &db, const QString &table);
+    bool load(const QSqlDatabase &db, const Relation &relation, Lookup *lookup) const;
+    Lookup *lookup(const QSqlDatabase &db, int column);
+
+    QHash<int, Relation> m_relations;
+    QHash<QString, Lookup> m_lookups;
+    QSet<QString> m_tracked;
+    bool m_versioned = false;   // relation_versions was read
+    bool m_tracking = false;
+    qint64 m_dataVersion = -1;
+    qint64 m_changes = -1;
+};
+
+#endif // RELATIONCACHE_H
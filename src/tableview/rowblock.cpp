@@ -0,0 +1,483 @@
+/**
+ * QML examples - Qt5 and QML examples
+ * Copyright (c) 2019 Yuri Young<yuri.young@qq.com>
+ *
+ * This examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "rowblock.h"
+
+#include <QBitArray>
+#include <QHash>
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QSqlField>
+#include <QStringList>
+
+class RowColumn
+{
+public:
+    bool fits(const QVariant &value) const;
+    void promote(int rows);
+    void append(const QVariant &value, int row);
+    void remove(int row, int rows);
+    QVariant value(int row) const;
+    quint32 intern(const QString &text);
+
+    RowBlock::Storage storage = RowBlock::VariantStorage;
+    QBitArray nulls;
+    QVector<qint64> integers;
+    QVector<double> reals;
+    QVector<quint32> codes;
+    QVector<QString> dictionary;
+    QHash<QString, quint32> lookup;
+    QVector<quint32> offsets;
+    QVector<quint32> lengths;
+    QString arena;
+    QVector<QVariant> variants;
+};
+
+class RowBlockData : public QSharedData
+{
+public:
+    QVector<RowColumn> columns;
+    int rows = 0;
+};
+
+/**
+ * @brief whether a value can be kept in the storage of the column
+ * @param value
+ * @return
+ */
+bool RowColumn::fits(const QVariant &value) const
+{
+    if(value.isNull())
+        return true;
+
+    switch (storage)
+    {
+    case RowBlock::IntegerStorage:
+        switch (value.userType())
+        {
+        case QMetaType::Int:
+        case QMetaType::UInt:
+        case QMetaType::LongLong:
+        case QMetaType::ULongLong:
+        case QMetaType::Bool:
+            return true;
+        default:
+            return false;
+        }
+    case RowBlock::RealStorage:
+        return value.userType() == QMetaType::Double;
+    case RowBlock::InternedStorage:
+    case RowBlock::TextStorage:
+        return value.userType() == QMetaType::QString;
+    case RowBlock::VariantStorage:
+        break;
+    }
+
+    return true;
+}
+
+/**
+ * @brief turn the column into plain variants
+ * @param rows
+ */
+void RowColumn::promote(int rows)
+{
+    QVector<QVariant> values;
+    values.reserve(rows);
+    for (int i = 0; i < rows; ++i)
+        values.append(value(i));
+
+    integers = QVector<qint64>();
+    reals = QVector<double>();
+    codes = QVector<quint32>();
+    dictionary = QVector<QString>();
+    lookup = QHash<QString, quint32>();
+    offsets = QVector<quint32>();
+    lengths = QVector<quint32>();
+    arena = QString();
+    variants = values;
+    storage = RowBlock::VariantStorage;
+}
+
+void RowColumn::append(const QVariant &value, int row)
+{
+    if(!fits(value))
+        promote(row);
+
+    const bool null = value.isNull();
+    nulls.resize(row + 1);
+    nulls.setBit(row, null);
+
+    switch (storage)
+    {
+    case RowBlock::IntegerStorage:
+        integers.append(null ? 0 : value.toLongLong());
+        break;
+    case RowBlock::RealStorage:
+        reals.append(null ? 0 : value.toDouble());
+        break;
+    case RowBlock::InternedStorage:
+        codes.append(null ? 0 : intern(value.toString()));
+        break;
+    case RowBlock::TextStorage:
+    {
+        const QString text = null ? QString() : value.toString();
+        offsets.append(quint32(arena.size()));
+        lengths.append(quint32(text.size()));
+        arena.append(text);
+        break;
+    }
+    case RowBlock::VariantStorage:
+        variants.append(value);
+        break;
+    }
+}
+
+void RowColumn::remove(int row, int rows)
+{
+    for (int i = row; i < rows - 1; ++i)
+        nulls.setBit(i, nulls.testBit(i + 1));
+    nulls.resize(rows - 1);
+
+    switch (storage)
+    {
+    case RowBlock::IntegerStorage:
+        integers.remove(row);
+        break;
+    case RowBlock::RealStorage:
+        reals.remove(row);
+        break;
+    case RowBlock::InternedStorage:
+        codes.remove(row);
+        break;
+    case RowBlock::TextStorage:
+        // the slice stays in the arena until the block is dropped
+        offsets.remove(row);
+        lengths.remove(row);
+        break;
+    case RowBlock::VariantStorage:
+        variants.remove(row);
+        break;
+    }
+}
+
+QVariant RowColumn::value(int row) const
+{
+    if(storage == RowBlock::VariantStorage)
+        return variants.at(row);
+
+    // the sqlite driver reports NULL as a null string
+    if(nulls.testBit(row))
+        return QVariant(QString());
+
+    switch (storage)
+    {
+    case RowBlock::IntegerStorage:
+        return QVariant(integers.at(row));
+    case RowBlock::RealStorage:
+        return QVariant(reals.at(row));
+    case RowBlock::InternedStorage:
+        return QVariant(dictionary.at(int(codes.at(row))));
+    case RowBlock::TextStorage:
+        return QVariant(arena.mid(int(offsets.at(row)), int(lengths.at(row))));
+    case RowBlock::VariantStorage:
+        break;
+    }
+
+    return QVariant();
+}
+
+quint32 RowColumn::intern(const QString &text)
+{
+    auto it = lookup.constFind(text);
+    if(it != lookup.constEnd())
+        return it.value();
+
+    quint32 code = quint32(dictionary.size());
+    dictionary.append(text);
+    lookup.insert(text, code);
+    return code;
+}
+
+/**
+ * @brief choose the storage of each field of a record
+ * @param record
+ * @param internedFields string fields with few distinct values
+ * @return
+ */
+RowBlock::Layout RowBlock::layout(const QSqlRecord &record, const QStringList &internedFields)
+{
+    Layout layout;
+    layout.reserve(record.count());
+    for (int i = 0; i < record.count(); ++i)
+    {
+        const QSqlField field = record.field(i);
+        switch (field.type())
+        {
+        case QVariant::Int:
+        case QVariant::UInt:
+        case QVariant::LongLong:
+        case QVariant::ULongLong:
+        case QVariant::Bool:
+            layout << IntegerStorage;
+            break;
+        case QVariant::Double:
+            layout << RealStorage;
+            break;
+        case QVariant::String:
+            layout << (internedFields.contains(field.name(), Qt::CaseInsensitive)
+                       ? InternedStorage
+                       : TextStorage);
+            break;
+        default:
+            layout << VariantStorage;
+            break;
+        }
+    }
+
+    return layout;
+}
+
+RowBlock::RowBlock()
+    : d(new RowBlockData())
+{
+
+}
+
+RowBlock::RowBlock(const Layout &layout)
+    : d(new RowBlockData())
+{
+    d->columns.resize(layout.count());
+    for (int i = 0; i < layout.count(); ++i)
+        d->columns[i].storage = layout.at(i);
+}
+
+RowBlock::RowBlock(const RowBlock &other)
+    : d(other.d)
+{
+
+}
+
+RowBlock &RowBlock::operator=(const RowBlock &other)
+{
+    d = other.d;
+    return *this;
+}
+
+RowBlock::~RowBlock()
+{
+
+}
+
+int RowBlock::rowCount() const
+{
+    return d->rows;
+}
+
+int RowBlock::columnCount() const
+{
+    return d->columns.count();
+}
+
+bool RowBlock::isEmpty() const
+{
+    return d->rows == 0;
+}
+
+RowBlock::Layout RowBlock::storage() const
+{
+    Layout layout;
+    for (const RowColumn &column : d->columns)
+        layout << column.storage;
+    return layout;
+}
+
+void RowBlock::reserve(int rows)
+{
+    for (RowColumn &column : d->columns)
+    {
+        switch (column.storage)
+        {
+        case IntegerStorage:
+            column.integers.reserve(rows);
+            break;
+        case RealStorage:
+            column.reals.reserve(rows);
+            break;
+        case InternedStorage:
+            column.codes.reserve(rows);
+            break;
+        case TextStorage:
+            column.offsets.reserve(rows);
+            column.lengths.reserve(rows);
+            break;
+        case VariantStorage:
+            column.variants.reserve(rows);
+            break;
+        }
+    }
+}
+
+/**
+ * @brief append the current row of a query, its columns follow the layout
+ * @param query
+ */
+void RowBlock::append(const QSqlQuery &query)
+{
+    const int row = d->rows;
+    for (int i = 0; i < d->columns.count(); ++i)
+        d->columns[i].append(query.value(i), row);
+    ++d->rows;
+}
+
+void RowBlock::append(const QVector<QVariant> &values)
+{
+    const int row = d->rows;
+    for (int i = 0; i < d->columns.count(); ++i)
+        d->columns[i].append(values.value(i), row);
+    ++d->rows;
+}
+
+void RowBlock::append(const RowBlock &other)
+{
+    if(d->columns.isEmpty())
+    {
+        *this = RowBlock(other.storage());
+    }
+
+    for (int row = 0; row < other.rowCount(); ++row)
+    {
+        const int target = d->rows;
+        for (int i = 0; i < d->columns.count(); ++i)
+            d->columns[i].append(other.value(row, i), target);
+        ++d->rows;
+    }
+}
+
+/**
+ * @brief insert the rows of another block before a row,
+ * the columns are copied into a new block
+ * @param row
+ * @param other
+ */
+void RowBlock::insert(int row, const RowBlock &other)
+{
+    row = qBound(0, row, d->rows);
+    if(row == d->rows || d->columns.isEmpty())
+    {
+        append(other);
+        return;
+    }
+
+    RowBlock block(storage());
+    block.reserve(d->rows + other.rowCount());
+    QVector<QVariant> values(d->columns.count());
+    for (int i = 0; i < d->rows; ++i)
+    {
+        if(i == row)
+            block.append(other);
+
+        for (int j = 0; j < d->columns.count(); ++j)
+            values[j] = d->columns.at(j).value(i);
+        block.append(values);
+    }
+    *this = block;
+}
+
+void RowBlock::remove(int row)
+{
+    if(row < 0 || row >= d->rows)
+        return;
+
+    for (RowColumn &column : d->columns)
+        column.remove(row, d->rows);
+    --d->rows;
+}
+
+void RowBlock::clear()
+{
+    *this = RowBlock(storage());
+}
+
+QVariant RowBlock::value(int row, int column) const
+{
+    if(row < 0 || row >= d->rows || column < 0 || column >= d->columns.count())
+        return QVariant();
+
+    return d->columns.at(column).value(row);
+}
+
+qint64 RowBlock::integer(int row, int column) const
+{
+    if(row < 0 || row >= d->rows || column < 0 || column >= d->columns.count())
+        return 0;
+
+    const RowColumn &col = d->columns.at(column);
+    if(col.storage == IntegerStorage)
+        return col.integers.at(row);
+
+    return col.value(row).toLongLong();
+}
+
+bool RowBlock::isNull(int row, int column) const
+{
+    if(row < 0 || row >= d->rows || column < 0 || column >= d->columns.count())
+        return true;
+
+    const RowColumn &col = d->columns.at(column);
+    if(col.storage == VariantStorage)
+        return col.variants.at(row).isNull();
+
+    return col.nulls.testBit(row);
+}
+
+void RowBlock::setValue(int row, int column, const QVariant &value)
+{
+    if(row < 0 || row >= d->rows || column < 0 || column >= d->columns.count())
+        return;
+
+    RowColumn &col = d->columns[column];
+    if(!col.fits(value))
+        col.promote(d->rows);
+
+    const bool null = value.isNull();
+    col.nulls.setBit(row, null);
+    switch (col.storage)
+    {
+    case IntegerStorage:
+        col.integers[row] = null ? 0 : value.toLongLong();
+        break;
+    case RealStorage:
+        col.reals[row] = null ? 0 : value.toDouble();
+        break;
+    case InternedStorage:
+        col.codes[row] = null ? 0 : col.intern(value.toString());
+        break;
+    case TextStorage:
+    {
+        const QString text = null ? QString() : value.toString();
+        col.offsets[row] = quint32(col.arena.size());
+        col.lengths[row] = quint32(text.size());
+        col.arena.append(text);
+        break;
+    }
+    case VariantStorage:
+        col.variants[row] = value;
+        break;
+    }
+}
@@ -0,0 +1,79 @@
+/**
+ * QML examples - Qt5 and QML examples
+ * Copyright (c) 2019 Yuri Young<yuri.young@qq.com>
+ *
+ * This examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ROWBLOCK_H
+#define ROWBLOCK_H
+
+#include <QSharedDataPointer>
+#include <QVariant>
+#include <QVector>
+
+class QSqlQuery;
+class QSqlRecord;
+class RowBlockData;
+
+/**
+ * @brief a block of rows stored column by column in typed arrays.
+ * integer columns are kept as int64, low cardinality strings are interned
+ * in a dictionary of the block, other strings are slices of one text arena.
+ * values a column can not hold in its storage turn that column into
+ * plain variants for the block.
+ */
+class RowBlock
+{
+public:
+    enum Storage {
+        IntegerStorage = 0,
+        RealStorage,
+        InternedStorage,
+        TextStorage,
+        VariantStorage
+    };
+    typedef QVector<Storage> Layout;
+
+    static Layout layout(const QSqlRecord &record, const QStringList &internedFields = QStringList());
+
+    RowBlock();
+    explicit RowBlock(const Layout &layout);
+    RowBlock(const RowBlock &other);
+    RowBlock &operator=(const RowBlock &other);
+    ~RowBlock();
+
+    int rowCount() const;
+    int columnCount() const;
+    bool isEmpty() const;
+    Layout storage() const;
+
+    void reserve(int rows);
+    void append(const QSqlQuery &query);
+    void append(const QVector<QVariant> &values);
+    void append(const RowBlock &other);
+    void insert(int row, const RowBlock &other);
+    void remove(int row);
+    void clear();
+
+    QVariant value(int row, int column) const;
+    qint64 integer(int row, int column) const;
+    bool isNull(int row, int column) const;
+    void setValue(int row, int column, const QVariant &value);
+
+private:
+    QSharedDataPointer<RowBlockData> d;
+};
+
+#endif // ROWBLOCK_H
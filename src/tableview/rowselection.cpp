@@ -0,0 +1,270 @@
+/**
+ * QML examples - Qt5 and QML examples
+ * Copyright (c) 2019 Yuri Young<yuri.young@qq.com>
+ *
+ * This examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "rowselection.h"
+
+#include <algorithm>
+
+RowSelection::const_iterator::const_iterator(const QVector<Range> *ranges, int range)
+    : m_ranges(ranges)
+    , m_range(range)
+    , m_row(range < ranges->count() ? ranges->at(range).first : 0)
+{
+
+}
+
+RowSelection::const_iterator &RowSelection::const_iterator::operator++()
+{
+    if(m_row < m_ranges->at(m_range).last)
+    {
+        ++m_row;
+    }
+    else
+    {
+        ++m_range;
+        m_row = m_range < m_ranges->count() ? m_ranges->at(m_range).first : 0;
+    }
+
+    return *this;
+}
+
+RowSelection::const_iterator RowSelection::const_iterator::operator++(int)
+{
+    const_iterator it = *this;
+    ++(*this);
+    return it;
+}
+
+bool RowSelection::const_iterator::operator==(const const_iterator &other) const
+{
+    return m_ranges == other.m_ranges && m_range == other.m_range && m_row == other.m_row;
+}
+
+RowSelection::RowSelection()
+{
+
+}
+
+bool RowSelection::contains(int row) const
+{
+    auto it = std::upper_bound(m_ranges.constBegin(), m_ranges.constEnd(), row,
+                               [](int value, const Range &range) { return value < range.first; });
+    if(it == m_ranges.constBegin())
+        return false;
+
+    --it;
+    return row <= it->last;
+}
+
+/**
+ * @brief add the rows from first to last, merging touching ranges
+ * @param first
+ * @param last
+ */
+void RowSelection::select(int first, int last)
+{
+    if(first > last || last < 0)
+        return;
+    first = qMax(0, first);
+
+    // rows added in ascending order
+    if(m_ranges.isEmpty() || first > m_ranges.last().last)
+    {
+        if(!m_ranges.isEmpty() && m_ranges.last().last + 1 == first)
+            m_ranges.last().last = last;
+        else
+            m_ranges.append({ first, last });
+        m_count += last - first + 1;
+        return;
+    }
+
+    QVector<Range> ranges;
+    ranges.reserve(m_ranges.count() + 1);
+    Range added = { first, last };
+    bool inserted = false;
+    for (const Range &range : m_ranges)
+    {
+        if(range.last + 1 < added.first)
+        {
+            ranges.append(range);
+        }
+        else if(added.last + 1 < range.first)
+        {
+            if(!inserted)
+            {
+                ranges.append(added);
+                inserted = true;
+            }
+            ranges.append(range);
+        }
+        else
+        {
+            added.first = qMin(added.first, range.first);
+            added.last = qMax(added.last, range.last);
+        }
+    }
+
+    if(!inserted)
+        ranges.append(added);
+
+    m_ranges = ranges;
+    updateCount();
+}
+
+void RowSelection::deselect(int first, int last)
+{
+    if(first > last || m_ranges.isEmpty())
+        return;
+
+    QVector<Range> ranges;
+    ranges.reserve(m_ranges.count() + 1);
+    for (const Range &range : m_ranges)
+    {
+        if(range.last < first || range.first > last)
+        {
+            ranges.append(range);
+            continue;
+        }
+
+        if(range.first < first)
+            ranges.append({ range.first, first - 1 });
+        if(range.last > last)
+            ranges.append({ last + 1, range.last });
+    }
+
+    m_ranges = ranges;
+    updateCount();
+}
+
+void RowSelection::selectAll(int rows)
+{
+    m_ranges.clear();
+    if(rows > 0)
+        m_ranges.append({ 0, rows - 1 });
+    updateCount();
+}
+
+/**
+ * @brief select the unselected rows of a table and deselect the others
+ * @param rows the number of rows of the table
+ */
+void RowSelection::invert(int rows)
+{
+    QVector<Range> ranges;
+    int next = 0;
+    for (const Range &range : m_ranges)
+    {
+        if(range.first >= rows)
+            break;
+        if(range.first > next)
+            ranges.append({ next, range.first - 1 });
+        next = range.last + 1;
+    }
+
+    if(next < rows)
+        ranges.append({ next, rows - 1 });
+
+    m_ranges = ranges;
+    updateCount();
+}
+
+void RowSelection::clear()
+{
+    m_ranges.clear();
+    m_count = 0;
+}
+
+/**
+ * @brief shift the selection after rows were inserted, new rows are not selected
+ * @param first
+ * @param count
+ */
+void RowSelection::insertRows(int first, int count)
+{
+    if(count <= 0)
+        return;
+
+    QVector<Range> ranges;
+    ranges.reserve(m_ranges.count() + 1);
+    for (const Range &range : m_ranges)
+    {
+        if(range.last < first)
+        {
+            ranges.append(range);
+        }
+        else if(range.first >= first)
+        {
+            ranges.append({ range.first + count, range.last + count });
+        }
+        else
+        {
+            ranges.append({ range.first, first - 1 });
+            ranges.append({ first + count, range.last + count });
+        }
+    }
+
+    m_ranges = ranges;
+}
+
+/**
+ * @brief shift the selection after rows were removed
+ * @param first
+ * @param count
+ */
+void RowSelection::removeRows(int first, int count)
+{
+    if(count <= 0)
+        return;
+
+    deselect(first, first + count - 1);
+
+    QVector<Range> ranges;
+    ranges.reserve(m_ranges.count());
+    for (Range range : m_ranges)
+    {
+        if(range.first > first)
+        {
+            range.first -= count;
+            range.last -= count;
+        }
+
+        if(!ranges.isEmpty() && ranges.last().last + 1 == range.first)
+            ranges.last().last = range.last;
+        else
+            ranges.append(range);
+    }
+
+    m_ranges = ranges;
+}
+
+RowSelection::const_iterator RowSelection::begin() const
+{
+    return const_iterator(&m_ranges, 0);
+}
+
+RowSelection::const_iterator RowSelection::end() const
+{
+    return const_iterator(&m_ranges, m_ranges.count());
+}
+
+void RowSelection::updateCount()
+{
+    m_count = 0;
+    for (const Range &range : m_ranges)
+        m_count += range.last - range.first + 1;
+}
@@ -0,0 +1,87 @@
+/**
+ * QML examples - Qt5 and QML examples
+ * Copyright (c) 2019 Yuri Young<yuri.young@qq.com>
+ *
+ * This examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ROWSELECTION_H
+#define ROWSELECTION_H
+
+#include <QVector>
+#include <iterator>
+
+/**
+ * @brief a set of selected rows kept as sorted, disjoint ranges.
+ * selecting every row of a table is a single range, whatever its size.
+ */
+class RowSelection
+{
+public:
+    struct Range
+    {
+        int first;
+        int last;
+    };
+
+    class const_iterator
+    {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef int value_type;
+        typedef int difference_type;
+        typedef const int *pointer;
+        typedef const int &reference;
+
+        const_iterator(const QVector<Range> *ranges, int range);
+
+        int operator*() const { return m_row; }
+        const_iterator &operator++();
+        const_iterator operator++(int);
+        bool operator==(const const_iterator &other) const;
+        bool operator!=(const const_iterator &other) const { return !(*this == other); }
+
+    private:
+        const QVector<Range> *m_ranges;
+        int m_range;
+        int m_row;
+    };
+
+    RowSelection();
+
+    int count() const { return m_count; }
+    bool isEmpty() const { return m_count == 0; }
+    bool contains(int row) const;
+    QVector<Range> ranges() const { return m_ranges; }
+
+    void select(int first, int last);
+    void deselect(int first, int last);
+    void selectAll(int rows);
+    void invert(int rows);
+    void clear();
+
+    void insertRows(int first, int count);
+    void removeRows(int first, int count);
+
+    const_iterator begin() const;
+    const_iterator end() const;
+
+private:
+    void updateCount();
+
+    QVector<Range> m_ranges;
+    int m_count = 0;
+};
+
+#endif // ROWSELECTION_H
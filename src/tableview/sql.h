@@ -29,31 +29,31 @@
 #include <QSqlError>
 #include <QSqlQuery>
 #include <QFile>
-#include <QThreadStorage>
 #include <QUuid>
 #include <QDebug>
 
-const QString DRIVER = "QSQLITE";
-static QThreadStorage<QSqlDatabase> databasePool;
+#include "statementcache.h"
+#include "connectionpool.h"
 
 namespace Sql
 {
+    /**
+     * @brief the connection of the calling thread, kept by the connection
+     * pool and closed when the thread finishes. short lived work on other
+     * threads checks a connection out with PooledConnection instead.
+     */
     static QSqlDatabase database(const QString &databaseName = QString(), bool open = true)
     {
-        QSqlDatabase db;
+        return ConnectionPool::instance()->threadConnection(databaseName, open);
+    }
 
-        if(!databasePool.hasLocalData())
-        {
-            QString connName = QUuid::createUuid().toString(QUuid::Id128);
-            db = QSqlDatabase::addDatabase(DRIVER, connName);
-            if(!databaseName.isEmpty())
-                db.setDatabaseName(databaseName);
-            if(open)
-                db = QSqlDatabase::database(connName, open);
-            databasePool.setLocalData(db);
-        }
-        db = databasePool.localData();
-        return db;
+    /**
+     * @brief a prepared statement of the connection, reused from the
+     * statement cache of the calling thread
+     */
+    static QSqlQuery statement(const QString &sql, const QSqlDatabase &db = database())
+    {
+        return StatementCache::local()->prepare(db, sql);
     }
 
     static QSqlDatabase connection(const QString &connectionName)
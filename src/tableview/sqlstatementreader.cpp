@@ -0,0 +1,242 @@
+/**
+ * QML examples - Qt5 and QML examples
+ * Copyright (c) 2019 Yuri Young<yuri.young@qq.com>
+ *
+ * This examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "sqlstatementreader.h"
+
+#include <QIODevice>
+
+static bool isWordChar(const QChar &c)
+{
+    return c.isLetterOrNumber() || c == '_' || c == '$';
+}
+
+/**
+ * @brief the device must be open for reading, the script is read as UTF-8
+ * @param device
+ * @param chunkSize characters read at a time
+ */
+SqlStatementReader::SqlStatementReader(QIODevice *device, int chunkSize)
+    : m_stream(device), m_chunkSize(qMax(16, chunkSize))
+{
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+    m_stream.setCodec("UTF-8");
+#else
+    m_stream.setEncoding(QStringConverter::Utf8);
+#endif
+
+    if(!device || !device->isReadable())
+        m_error = device ? device->errorString() : QString("No device");
+}
+
+/**
+ * @brief read the next statement
+ * @return false at the end of the script, or on error
+ */
+bool SqlStatementReader::next()
+{
+    m_statement.clear();
+    m_startLine = -1;
+    m_word.clear();
+    m_head.clear();
+    m_trigger = false;
+    m_depth = 0;
+    if(!m_error.isEmpty())
+        return false;
+
+    State state = Normal;
+    QChar quote;
+    while (fill(1))
+    {
+        const QChar c = m_buffer.at(m_pos);
+        int length = 1;
+        bool keep = true;
+        if(c == '\n')
+            ++m_line;
+
+        switch (state)
+        {
+        case Normal:
+            if(isWordChar(c))
+            {
+                m_word += c;
+                break;
+            }
+
+            endWord();
+            if(c == '\'' || c == '"' || c == '`')
+            {
+                state = Quoted;
+                quote = c;
+            }
+            else if(c == '[')
+            {
+                state = Quoted;
+                quote = ']';
+            }
+            else if(c == '-' && at(1) == '-')
+            {
+                state = LineComment;
+                keep = false;
+                length = 2;
+            }
+            else if(c == '/' && at(1) == '*')
+            {
+                state = BlockComment;
+                keep = false;
+                length = 2;
+            }
+            else if(c == ';' && m_depth == 0)
+            {
+                ++m_pos;
+                m_statement = m_statement.trimmed();
+                if(!m_statement.isEmpty())
+                    return true;
+
+                m_startLine = -1;
+                m_head.clear();
+                m_trigger = false;
+                continue;
+            }
+            break;
+        case Quoted:
+            if(c == quote)
+            {
+                // a doubled quote stands for itself
+                if(quote != ']' && at(1) == quote)
+                    length = 2;
+                else
+                    state = Normal;
+            }
+            break;
+        case LineComment:
+            keep = c == '\n';
+            if(keep)
+                state = Normal;
+            break;
+        case BlockComment:
+            keep = false;
+            if(c == '*' && at(1) == '/')
+            {
+                length = 2;
+                state = Normal;
+                m_statement += ' ';
+            }
+            break;
+        }
+
+        if(keep)
+        {
+            if(m_startLine < 0 && !c.isSpace())
+                m_startLine = m_line;
+            m_statement += m_buffer.mid(m_pos, length);
+        }
+        m_pos += length;
+    }
+
+    if(m_stream.status() != QTextStream::Ok)
+        m_error = "Can not read the script";
+
+    // the last statement needs no semicolon
+    endWord();
+    m_statement = m_statement.trimmed();
+    return !m_statement.isEmpty();
+}
+
+QString SqlStatementReader::statement() const
+{
+    return m_statement;
+}
+
+/**
+ * @brief the line of the script the statement starts on
+ * @return
+ */
+int SqlStatementReader::lineNumber() const
+{
+    return m_startLine;
+}
+
+bool SqlStatementReader::hasError() const
+{
+    return !m_error.isEmpty();
+}
+
+QString SqlStatementReader::errorString() const
+{
+    return m_error;
+}
+
+/**
+ * @brief make count characters from the current position available
+ * @param count
+ * @return false at the end of the script
+ */
+bool SqlStatementReader::fill(int count)
+{
+    while (m_buffer.size() - m_pos < count)
+    {
+        if(m_stream.atEnd())
+            return false;
+
+        m_buffer.remove(0, m_pos);
+        m_pos = 0;
+        m_buffer += m_stream.read(m_chunkSize);
+    }
+
+    return true;
+}
+
+QChar SqlStatementReader::at(int offset)
+{
+    return fill(offset + 1) ? m_buffer.at(m_pos + offset) : QChar();
+}
+
+/**
+ * @brief a trigger is CREATE [TEMP|TEMPORARY] TRIGGER, its body ends
+ * with the END of its BEGIN, CASE expressions in it end with END as well
+ */
+void SqlStatementReader::endWord()
+{
+    if(m_word.isEmpty())
+        return;
+
+    const QString word = m_word.toUpper();
+    m_word.clear();
+
+    if(m_head.count() < 3)
+    {
+        m_head << word;
+        if(m_head.first() != "CREATE")
+            return;
+
+        m_trigger = m_trigger
+                || (m_head.count() == 2 && word == "TRIGGER")
+                || (m_head.count() == 3 && word == "TRIGGER" && (m_head.at(1) == "TEMP" || m_head.at(1) == "TEMPORARY"));
+        return;
+    }
+
+    if(!m_trigger)
+        return;
+
+    if(word == "BEGIN" && m_depth == 0)
+        ++m_depth;
+    else if(word == "CASE" && m_depth > 0)
+        ++m_depth;
+    else if(word == "END" && m_depth > 0)
+        --m_depth;
+}
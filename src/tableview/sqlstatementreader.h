@@ -0,0 +1,75 @@
+/**
+ * QML examples - Qt5 and QML examples
+ * Copyright (c) 2019 Yuri Young<yuri.young@qq.com>
+ *
+ * This examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SQLSTATEMENTREADER_H
+#define SQLSTATEMENTREADER_H
+
+#include <QTextStream>
+#include <QStringList>
+
+class QIODevice;
+
+/**
+ * @brief reads the statements of an sql script one at a time.
+ * the script is read in chunks, so only the statement being read is kept
+ * in memory. semicolons in quoted strings and identifiers, comments, and
+ * the BEGIN ... END body of a trigger do not end a statement.
+ * comments are dropped from the statements.
+ */
+class SqlStatementReader
+{
+    Q_DISABLE_COPY(SqlStatementReader)
+public:
+    explicit SqlStatementReader(QIODevice *device, int chunkSize = 64 * 1024);
+
+    bool next();
+    QString statement() const;
+    int lineNumber() const;
+
+    bool hasError() const;
+    QString errorString() const;
+
+private:
+    enum State {
+        Normal = 0,
+        Quoted,
+        LineComment,
+        BlockComment
+    };
+
+    bool fill(int count);
+    QChar at(int offset);
+    void endWord();
+
+    QTextStream m_stream;
+    QString m_buffer;
+    int m_pos = 0;
+    int m_chunkSize;
+    int m_line = 1;
+
+    // the statement being read
+    QString m_statement;
+    int m_startLine = -1;
+    QString m_word;
+    QStringList m_head;     // the first words, to tell a trigger
+    bool m_trigger = false;
+    int m_depth = 0;        // BEGIN and CASE blocks open in a trigger
+    QString m_error;
+};
+
+#endif // SQLSTATEMENTREADER_H
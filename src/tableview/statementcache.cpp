@@ -0,0 +1,168 @@
+/**
+ * QML examples - Qt5 and QML examples
+ * Copyright (c) 2019 Yuri Young<yuri.young@qq.com>
+ *
+ * This examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "statementcache.h"
+#include "connectionpool.h"
+
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QLoggingCategory>
+
+Q_LOGGING_CATEGORY(lcStatementCache, "app.StatementCache")
+
+// counters of statements no longer cached are kept up to this many
+static const int maxCounters = 1024;
+
+StatementCache::StatementCache(int capacity)
+    : m_capacity(qMax(1, capacity))
+{
+}
+
+/**
+ * @brief the cache of the calling thread, kept by the connection pool
+ * with the connections of the thread and deleted before them
+ * @return
+ */
+StatementCache *StatementCache::local()
+{
+    return ConnectionPool::instance()->statements();
+}
+
+void StatementCache::setCapacity(int capacity)
+{
+    m_capacity = qMax(1, capacity);
+    evict();
+}
+
+int StatementCache::capacity() const
+{
+    return m_capacity;
+}
+
+int StatementCache::count() const
+{
+    return m_entries.count();
+}
+
+/**
+ * @brief a prepared query for the statement, prepared on the first call
+ * and reset for new values on later calls. a query returned earlier for
+ * the same statement must be done with, both share one sqlite statement.
+ * @param db
+ * @param statement
+ * @return a query that failed to prepare is returned but not cached,
+ * its lastError() tells why
+ */
+QSqlQuery StatementCache::prepare(const QSqlDatabase &db, const QString &statement)
+{
+    const QString id = key(db, statement);
+    auto it = m_entries.find(id);
+    if(it != m_entries.end())
+    {
+        it->lastUsed = ++m_tick;
+        it->query.finish();
+        ++m_hits;
+        if(m_counters.contains(id) || m_counters.count() < maxCounters)
+            ++m_counters[id].hits;
+        return it->query;
+    }
+
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    if(!query.prepare(statement))
+    {
+        qWarning(lcStatementCache) << "Prepare statement error" << query.lastError().text();
+        return query;
+    }
+
+    ++m_prepares;
+    if(m_counters.contains(id) || m_counters.count() < maxCounters)
+        ++m_counters[id].prepares;
+
+    Entry entry;
+    entry.query = query;
+    entry.lastUsed = ++m_tick;
+    m_entries.insert(id, entry);
+    evict();
+    return query;
+}
+
+/**
+ * @brief drop the statements of a connection, they are finalized
+ * when it closes. call before closing or reopening a connection.
+ * @param db
+ */
+void StatementCache::invalidate(const QSqlDatabase &db)
+{
+    const QString prefix = db.connectionName() + '\n';
+    for (auto it = m_entries.begin(); it != m_entries.end(); )
+    {
+        if(it.key().startsWith(prefix))
+            it = m_entries.erase(it);
+        else
+            ++it;
+    }
+}
+
+void StatementCache::clear()
+{
+    m_entries.clear();
+}
+
+StatementCache::Counter StatementCache::counter(const QSqlDatabase &db, const QString &statement) const
+{
+    return m_counters.value(key(db, statement));
+}
+
+/**
+ * @brief counters by "<connection name>\n<statement>"
+ * @return
+ */
+QHash<QString, StatementCache::Counter> StatementCache::counters() const
+{
+    return m_counters;
+}
+
+int StatementCache::hits() const
+{
+    return m_hits;
+}
+
+int StatementCache::prepares() const
+{
+    return m_prepares;
+}
+
+QString StatementCache::key(const QSqlDatabase &db, const QString &statement)
+{
+    return db.connectionName() + '\n' + statement;
+}
+
+void StatementCache::evict()
+{
+    while (m_entries.count() > m_capacity)
+    {
+        auto victim = m_entries.begin();
+        for (auto it = m_entries.begin(); it != m_entries.end(); ++it)
+        {
+            if(it->lastUsed < victim->lastUsed)
+                victim = it;
+        }
+        m_entries.erase(victim);
+    }
+}
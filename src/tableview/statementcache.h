@@ -0,0 +1,79 @@
+/**
+ * QML examples - Qt5 and QML examples
+ * Copyright (c) 2019 Yuri Young<yuri.young@qq.com>
+ *
+ * This examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef STATEMENTCACHE_H
+#define STATEMENTCACHE_H
+
+#include <QHash>
+#include <QSqlQuery>
+
+class QSqlDatabase;
+
+/**
+ * @brief prepared statements kept for reuse, keyed by connection and SQL.
+ * a prepared QSqlQuery holds the compiled sqlite statement, executing it
+ * again only binds new values. the least recently used statements are
+ * finalized once the cache is full.
+ * connections belong to one thread, so each thread has a cache of its own,
+ * see local(). statements are forward only.
+ */
+class StatementCache
+{
+public:
+    struct Counter
+    {
+        int prepares = 0;
+        int hits = 0;
+    };
+
+    explicit StatementCache(int capacity = 64);
+
+    static StatementCache *local();
+
+    void setCapacity(int capacity);
+    int capacity() const;
+    int count() const;
+
+    QSqlQuery prepare(const QSqlDatabase &db, const QString &statement);
+    void invalidate(const QSqlDatabase &db);
+    void clear();
+
+    Counter counter(const QSqlDatabase &db, const QString &statement) const;
+    QHash<QString, Counter> counters() const;
+    int hits() const;
+    int prepares() const;
+
+private:
+    struct Entry
+    {
+        QSqlQuery query;
+        quint64 lastUsed = 0;
+    };
+
+    static QString key(const QSqlDatabase &db, const QString &statement);
+    void evict();
+
+    int m_capacity;
+    quint64 m_tick = 0;
+    int m_hits = 0;
+    int m_prepares = 0;
+    QHash<QString, Entry> m_entries;
+    QHash<QString, Counter> m_counters;
+};
+
+#endif // STATEMENTCACHE_H
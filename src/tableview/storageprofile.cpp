@@ -0,0 +1,119 @@
+/**
+ * QML examples - Qt5 and QML examples
+ * Copyright (c) 2019 Yuri Young<yuri.young@qq.com>
+ *
+ * This examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "storageprofile.h"
+
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QLoggingCategory>
+
+Q_LOGGING_CATEGORY(lcStorageProfile, "app.StorageProfile")
+
+QList<StorageProfile::Profile> StorageProfile::profiles()
+{
+    return { Default, ReadHeavy, WriteHeavy, InMemory };
+}
+
+QString StorageProfile::name(Profile profile)
+{
+    switch (profile)
+    {
+    case ReadHeavy: return "readHeavy";
+    case WriteHeavy: return "writeHeavy";
+    case InMemory: return "inMemory";
+    default: return "default";
+    }
+}
+
+StorageProfile::Profile StorageProfile::fromName(const QString &name, bool *ok)
+{
+    for (Profile profile : profiles())
+    {
+        if(!name.compare(StorageProfile::name(profile), Qt::CaseInsensitive))
+        {
+            if(ok) *ok = true;
+            return profile;
+        }
+    }
+
+    if(ok) *ok = name.isEmpty();
+    return Default;
+}
+
+QStringList StorageProfile::pragmas(Profile profile)
+{
+    switch (profile)
+    {
+    case ReadHeavy:
+        return {
+            "PRAGMA journal_mode = WAL",
+            "PRAGMA synchronous = NORMAL",
+            "PRAGMA mmap_size = 268435456",     // 256 MiB
+            "PRAGMA cache_size = -65536",       // 64 MiB
+            "PRAGMA temp_store = MEMORY"
+        };
+    case WriteHeavy:
+        return {
+            "PRAGMA journal_mode = WAL",
+            "PRAGMA synchronous = NORMAL",
+            "PRAGMA wal_autocheckpoint = 4000",
+            "PRAGMA mmap_size = 0",
+            "PRAGMA cache_size = -16384",       // 16 MiB
+            "PRAGMA temp_store = MEMORY"
+        };
+    case InMemory:
+        return {
+            "PRAGMA journal_mode = MEMORY",
+            "PRAGMA synchronous = OFF",
+            "PRAGMA mmap_size = 0",
+            "PRAGMA cache_size = -65536",
+            "PRAGMA temp_store = MEMORY"
+        };
+    default:
+        return {
+            "PRAGMA journal_mode = WAL"
+        };
+    }
+}
+
+/**
+ * @brief apply the pragmas of a profile to an open connection
+ * @param db
+ * @param profile
+ * @return false if a pragma failed, the rest are still applied
+ */
+bool StorageProfile::apply(const QSqlDatabase &db, Profile profile)
+{
+    if(!db.isOpen())
+        return false;
+
+    bool ok = true;
+    QSqlQuery query(db);
+    for (const QString &pragma : pragmas(profile))
+    {
+        if(!query.exec(pragma))
+        {
+            qWarning(lcStorageProfile) << pragma << "failed:" << query.lastError().text();
+            ok = false;
+        }
+        query.finish();
+    }
+
+    return ok;
+}
@@ -0,0 +1,52 @@
+/**
+ * QML examples - Qt5 and QML examples
+ * Copyright (c) 2019 Yuri Young<yuri.young@qq.com>
+ *
+ * This examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef STORAGEPROFILE_H
+#define STORAGEPROFILE_H
+
+#include <QStringList>
+
+class QSqlDatabase;
+
+/**
+ * @brief named sets of sqlite pragmas applied when a connection opens.
+ * ReadHeavy maps the database file into memory and keeps a large page
+ * cache, WriteHeavy commits to the WAL without waiting for the disk on
+ * every transaction, InMemory keeps the journal and temp tables in memory
+ * and does not sync at all, for scratch databases that can be rebuilt.
+ * journal_mode is stored in the database file: a database can not leave
+ * WAL while other connections have it open.
+ */
+class StorageProfile
+{
+public:
+    enum Profile {
+        Default = 0,
+        ReadHeavy,
+        WriteHeavy,
+        InMemory
+    };
+
+    static QList<Profile> profiles();
+    static QString name(Profile profile);
+    static Profile fromName(const QString &name, bool *ok = nullptr);
+    static QStringList pragmas(Profile profile);
+    static bool apply(const QSqlDatabase &db, Profile profile);
+};
+
+#endif // STORAGEPROFILE_H
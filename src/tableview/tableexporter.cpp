@@ -0,0 +1,366 @@
+/**
+ * QML examples - Qt5 and QML examples
+ * Copyright (c) 2019 Yuri Young<yuri.young@qq.com>
+ *
+ * This examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tableexporter.h"
+#include "connectionpool.h"
+
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QSqlError>
+#include <QRunnable>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QCborStreamWriter>
+#include <QLoggingCategory>
+
+#include <memory>
+
+Q_LOGGING_CATEGORY(lcTableExporter, "app.TableExporter")
+
+// progress is reported at most this often, in milliseconds
+static const int progressInterval = 100;
+
+namespace {
+
+class RowWriter
+{
+public:
+    virtual ~RowWriter() = default;
+    virtual void begin(const QStringList &fields) { m_fields = fields; }
+    virtual void write(const QSqlQuery &query) = 0;
+    virtual void end() {}
+
+protected:
+    QStringList m_fields;
+};
+
+/**
+ * @brief RFC 4180, NULL is an empty field
+ */
+class CsvWriter : public RowWriter
+{
+public:
+    explicit CsvWriter(QIODevice *device) : m_device(device) {}
+
+    void begin(const QStringList &fields) override
+    {
+        RowWriter::begin(fields);
+        QByteArray line;
+        for (int i = 0; i < fields.count(); ++i)
+        {
+            if(i > 0)
+                line += ',';
+            line += quoted(fields.at(i));
+        }
+        m_device->write(line + "\r\n");
+    }
+
+    void write(const QSqlQuery &query) override
+    {
+        m_line.clear();
+        for (int i = 0; i < m_fields.count(); ++i)
+        {
+            if(i > 0)
+                m_line += ',';
+
+            const QVariant value = query.value(i);
+            if(value.isNull())
+                continue;
+            if(value.userType() == QMetaType::QByteArray)
+                m_line += value.toByteArray().toBase64();
+            else
+                m_line += quoted(value.toString());
+        }
+        m_line += "\r\n";
+        m_device->write(m_line);
+    }
+
+private:
+    static QByteArray quoted(const QString &text)
+    {
+        QByteArray data = text.toUtf8();
+        if(!data.contains(',') && !data.contains('"') && !data.contains('\n') && !data.contains('\r'))
+            return data;
+
+        data.replace('"', "\"\"");
+        return '"' + data + '"';
+    }
+
+    QIODevice *m_device;
+    QByteArray m_line;
+};
+
+/**
+ * @brief one JSON object per line, blobs are base64
+ */
+class JsonLinesWriter : public RowWriter
+{
+public:
+    explicit JsonLinesWriter(QIODevice *device) : m_device(device) {}
+
+    void write(const QSqlQuery &query) override
+    {
+        QJsonObject object;
+        for (int i = 0; i < m_fields.count(); ++i)
+        {
+            const QVariant value = query.value(i);
+            if(value.isNull())
+                object.insert(m_fields.at(i), QJsonValue::Null);
+            else if(value.userType() == QMetaType::QByteArray)
+                object.insert(m_fields.at(i), QString::fromLatin1(value.toByteArray().toBase64()));
+            else
+                object.insert(m_fields.at(i), QJsonValue::fromVariant(value));
+        }
+        m_device->write(QJsonDocument(object).toJson(QJsonDocument::Compact) + '\n');
+    }
+
+private:
+    QIODevice *m_device;
+};
+
+/**
+ * @brief an array of unknown length of maps, one per row
+ */
+class CborWriter : public RowWriter
+{
+public:
+    explicit CborWriter(QIODevice *device) : m_writer(device) {}
+
+    void begin(const QStringList &fields) override
+    {
+        RowWriter::begin(fields);
+        m_writer.startArray();
+    }
+
+    void write(const QSqlQuery &query) override
+    {
+        m_writer.startMap(quint64(m_fields.count()));
+        for (int i = 0; i < m_fields.count(); ++i)
+        {
+            m_writer.append(m_fields.at(i));
+            const QVariant value = query.value(i);
+            if(value.isNull())
+            {
+                m_writer.appendNull();
+                continue;
+            }
+
+            switch (value.userType())
+            {
+            case QMetaType::Int:
+            case QMetaType::LongLong:
+            case QMetaType::UInt:
+            case QMetaType::ULongLong:
+                m_writer.append(value.toLongLong());
+                break;
+            case QMetaType::Double:
+                m_writer.append(value.toDouble());
+                break;
+            case QMetaType::Bool:
+                m_writer.append(value.toBool());
+                break;
+            case QMetaType::QByteArray:
+                m_writer.append(value.toByteArray());
+                break;
+            default:
+                m_writer.append(value.toString());
+                break;
+            }
+        }
+        m_writer.endMap();
+    }
+
+    void end() override
+    {
+        m_writer.endArray();
+    }
+
+private:
+    QCborStreamWriter m_writer;
+};
+
+} // namespace
+
+class ExportTask : public QRunnable
+{
+public:
+    ExportTask(TableExporter *exporter, const TableExporter::Request &request)
+        : m_exporter(exporter), m_request(request)
+    {
+    }
+
+    void run() override
+    {
+        m_exporter->run(m_request);
+    }
+
+private:
+    TableExporter *m_exporter;
+    TableExporter::Request m_request;
+};
+
+TableExporter::TableExporter(QObject *parent)
+    : QObject(parent)
+{
+    m_pool.setMaxThreadCount(1);
+}
+
+/**
+ * @brief a running export is cancelled and waited for
+ */
+TableExporter::~TableExporter()
+{
+    cancel();
+    m_pool.waitForDone();
+}
+
+/**
+ * @brief start an export on the worker thread
+ * @param request
+ * @return false if an export is running already
+ */
+bool TableExporter::start(const Request &request)
+{
+    if(!m_running.testAndSetOrdered(0, 1))
+    {
+        qWarning(lcTableExporter) << "An export is running already";
+        return false;
+    }
+
+    m_cancelled.storeRelease(0);
+    m_pool.start(new ExportTask(this, request));
+    return true;
+}
+
+bool TableExporter::isRunning() const
+{
+    return m_running.loadAcquire() != 0;
+}
+
+TableExporter::Format TableExporter::formatOf(const QString &fileName)
+{
+    const QString suffix = QFileInfo(fileName).suffix().toLower();
+    if(suffix == "json" || suffix == "jsonl" || suffix == "ndjson")
+        return JsonLinesFormat;
+    if(suffix == "cbor")
+        return CborFormat;
+    return CsvFormat;
+}
+
+/**
+ * @brief stop a running export, the file is left as it was
+ */
+void TableExporter::cancel()
+{
+    m_cancelled.storeRelease(1);
+}
+
+void TableExporter::run(const Request &request)
+{
+    qint64 rows = 0;
+    QString error;
+    {
+        PooledConnection connection(request.databaseName, ConnectionPool::ReadMode);
+        QSqlDatabase db = connection.database();
+        qint64 total = -1;
+
+        QSaveFile file(request.fileName);
+        if(!db.isOpen())
+            error = "Can not open database " + db.lastError().text();
+        else if(!file.open(QIODevice::WriteOnly))
+            error = QString("Can not open file '%1' %2").arg(request.fileName, file.errorString());
+
+        if(error.isEmpty() && !request.countStatement.isEmpty())
+        {
+            QSqlQuery count(db);
+            count.setForwardOnly(true);
+            count.prepare(request.countStatement);
+            for (const QVariant &value : request.values)
+                count.addBindValue(value);
+            if(count.exec() && count.next())
+                total = count.value(0).toLongLong();
+        }
+
+        QSqlQuery query(db);
+        query.setForwardOnly(true);
+        if(error.isEmpty())
+        {
+            query.prepare(request.statement);
+            for (const QVariant &value : request.values)
+                query.addBindValue(value);
+            if(!query.exec())
+                error = "Read record error " + query.lastError().text();
+        }
+
+        if(error.isEmpty())
+        {
+            const Format format = request.format == AutoFormat ? formatOf(request.fileName) : request.format;
+            std::unique_ptr<RowWriter> writer;
+            if(format == JsonLinesFormat)
+                writer.reset(new JsonLinesWriter(&file));
+            else if(format == CborFormat)
+                writer.reset(new CborWriter(&file));
+            else
+                writer.reset(new CsvWriter(&file));
+
+            const QSqlRecord record = query.record();
+            QStringList fields;
+            for (int i = 0; i < record.count(); ++i)
+                fields << record.fieldName(i);
+
+            emit progress(0, total);
+            QElapsedTimer clock;
+            clock.start();
+            writer->begin(fields);
+            while (query.next())
+            {
+                writer->write(query);
+                ++rows;
+                if(m_cancelled.loadAcquire())
+                    break;
+                if(clock.elapsed() >= progressInterval)
+                {
+                    emit progress(rows, total);
+                    clock.restart();
+                }
+            }
+            writer->end();
+            query.finish();
+
+            if(m_cancelled.loadAcquire())
+                error = "Cancelled";
+            else if(query.lastError().type() != QSqlError::NoError)
+                error = "Read record error " + query.lastError().text();
+            else if(!file.commit())
+                error = QString("Can not write file '%1' %2").arg(request.fileName, file.errorString());
+            else
+                emit progress(rows, total);
+        }
+    }
+
+    if(error.isEmpty())
+        qDebug(lcTableExporter) << "exported" << rows << "rows to" << request.fileName;
+    else
+        qWarning(lcTableExporter) << "Export to" << request.fileName << "failed:" << error;
+
+    m_running.storeRelease(0);
+    emit finished(error.isEmpty(), rows, error);
+}
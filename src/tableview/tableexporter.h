@@ -0,0 +1,79 @@
+/**
+ * QML examples - Qt5 and QML examples
+ * Copyright (c) 2019 Yuri Young<yuri.young@qq.com>
+ *
+ * This examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TABLEEXPORTER_H
+#define TABLEEXPORTER_H
+
+#include <QObject>
+#include <QVariant>
+#include <QAtomicInt>
+#include <QThreadPool>
+
+/**
+ * @brief writes the rows of a query to a CSV, NDJSON or CBOR file on a
+ * worker thread. the rows are read forward only and written as they come,
+ * so the export runs in constant memory. the file is replaced only when
+ * the export completes.
+ */
+class TableExporter : public QObject
+{
+    Q_OBJECT
+public:
+    enum Format {
+        AutoFormat = 0,     // by the file suffix, CSV if unknown
+        CsvFormat,
+        JsonLinesFormat,
+        CborFormat
+    };
+    Q_ENUM(Format)
+
+    struct Request
+    {
+        QString databaseName;
+        QString statement;
+        QVariantList values;
+        QString countStatement;     // optional, the total for progress
+        QString fileName;
+        Format format = AutoFormat;
+    };
+
+    explicit TableExporter(QObject *parent = nullptr);
+    ~TableExporter() override;
+
+    bool start(const Request &request);
+    bool isRunning() const;
+
+    static Format formatOf(const QString &fileName);
+
+public slots:
+    void cancel();
+
+signals:
+    void progress(qint64 rows, qint64 total);
+    void finished(bool ok, qint64 rows, const QString &error);
+
+private:
+    friend class ExportTask;
+    void run(const Request &request);
+
+    QThreadPool m_pool;
+    QAtomicInt m_running;
+    QAtomicInt m_cancelled;
+};
+
+#endif // TABLEEXPORTER_H
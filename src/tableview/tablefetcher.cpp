@@ -0,0 +1,162 @@
+/**
+ * QML examples - Qt5 and QML examples
+ * Copyright (c) 2019 Yuri Young<yuri.young@qq.com>
+ *
+ * This examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tablefetcher.h"
+#include "sql.h"
+#include "queryprofiler.h"
+
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QLoggingCategory>
+
+Q_LOGGING_CATEGORY(lcTableFetcher, "app.TableFetcher")
+
+/**
+ * @brief runs keyset queries of a TableModel off the GUI thread.
+ * it lives in a thread of its own and reads through a query only
+ * connection checked out of the connection pool for each request.
+ * @param parent
+ */
+TableFetcher::TableFetcher(QObject *parent)
+    : QObject(parent)
+{
+    qRegisterMetaType<TableRows>();
+}
+
+/**
+ * @brief requests of an older generation are cancelled,
+ * may be called from any thread.
+ * @param generation
+ */
+void TableFetcher::setGeneration(int generation)
+{
+    m_generation.storeRelease(generation);
+}
+
+int TableFetcher::generation() const
+{
+    return m_generation.loadAcquire();
+}
+
+void TableFetcher::fetch(const TableFetchRequest &request)
+{
+    if(isCancelled(request))
+        return;
+
+    PooledConnection connection(request.databaseName, ConnectionPool::ReadMode);
+    QSqlDatabase db = connection.database();
+    if(!db.isOpen())
+    {
+        emit failed(request.generation, "Can not open database " + db.lastError().text());
+        if(request.isSelect())
+            emit finished(request.generation);
+        dropReload(request);
+        return;
+    }
+
+    if(request.count)
+    {
+        QSqlQuery count = Sql::statement(request.query.countStatement(), db);
+        for (const QVariant &value : request.query.whereValues)
+            count.addBindValue(value);
+        if(QueryProfiler::exec(count, "fetcher") && count.next())
+            emit counted(request.generation, count.value(0).toInt());
+        count.finish();
+    }
+
+    if(request.countOnly)
+        return;
+
+    // the seek condition changes with the cursor, take another statement only then
+    QSqlQuery query;
+    QString prepared;
+    TableCursor after = request.after;
+    bool last = false;
+    while (!last && !isCancelled(request))
+    {
+        const QString statement = request.query.pageStatement(after);
+        if(statement != prepared)
+        {
+            query = Sql::statement(statement, db);
+            prepared = statement;
+        }
+
+        for (const QVariant &value : request.query.pageValues(after, request.batchSize))
+            query.addBindValue(value);
+        if(!QueryProfiler::exec(query, "fetcher"))
+        {
+            emit failed(request.generation, "Read record error " + query.lastError().text());
+            dropReload(request);
+            break;
+        }
+
+        TableRows batch;
+        batch.generation = request.generation;
+        batch.after = after;
+        batch.reload = request.reload;
+        batch.rows = RowBlock(request.layout);
+        batch.rows.reserve(request.batchSize);
+        while (query.next())
+        {
+            batch.rows.append(query);
+            if(isCancelled(request))
+                break;
+        }
+        query.finish();
+
+        if(isCancelled(request))
+            break;
+
+        last = batch.rows.rowCount() < request.batchSize;
+        batch.last = last;
+        if(!batch.rows.isEmpty())
+            after = request.query.cursor(batch.rows, batch.rows.rowCount() - 1);
+
+        emit fetched(batch);
+
+        if(!request.stream)
+            break;
+    }
+
+    // a page read back is not part of the select, loading is left as it is
+    qDebug(lcTableFetcher) << "fetch finished, generation" << request.generation;
+    if(request.isSelect())
+        emit finished(request.generation);
+}
+
+/**
+ * @brief a page that can not be read back is answered without rows,
+ * so the model can ask for it again
+ * @param request
+ */
+void TableFetcher::dropReload(const TableFetchRequest &request)
+{
+    if(!request.reload)
+        return;
+
+    TableRows batch;
+    batch.generation = request.generation;
+    batch.after = request.after;
+    batch.reload = true;
+    emit fetched(batch);
+}
+
+bool TableFetcher::isCancelled(const TableFetchRequest &request) const
+{
+    return request.generation != m_generation.loadAcquire();
+}
@@ -0,0 +1,87 @@
+/**
+ * QML examples - Qt5 and QML examples
+ * Copyright (c) 2019 Yuri Young<yuri.young@qq.com>
+ *
+ * This examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TABLEFETCHER_H
+#define TABLEFETCHER_H
+
+#include <QObject>
+#include <QVector>
+#include <QAtomicInt>
+
+#include "rowblock.h"
+#include "tablequery.h"
+
+/**
+ * @brief a keyset query to run on the fetcher thread,
+ * reading the rows of the query after a cursor.
+ */
+struct TableFetchRequest
+{
+    int generation = 0;
+    QString databaseName;
+    TableQuery query;
+    RowBlock::Layout layout;
+    TableCursor after;
+    int batchSize = 256;
+    bool count = false;     // count the rows of the query first
+    bool stream = false;    // keep fetching until the end of the table
+    bool reload = false;    // read an evicted page back, after is its cursor
+    bool countOnly = false; // count the rows of the query and read none
+
+    bool isSelect() const { return !reload && !countOnly; }
+};
+
+/**
+ * @brief a batch of decoded rows
+ */
+struct TableRows
+{
+    int generation = 0;
+    TableCursor after;
+    RowBlock rows;
+    bool last = false;      // no more rows after this batch
+    bool reload = false;    // the rows of an evicted page
+};
+Q_DECLARE_METATYPE(TableRows)
+
+class TableFetcher : public QObject
+{
+    Q_OBJECT
+public:
+    explicit TableFetcher(QObject *parent = nullptr);
+
+    void setGeneration(int generation);
+    int generation() const;
+
+public slots:
+    void fetch(const TableFetchRequest &request);
+
+signals:
+    void counted(int generation, int total);
+    void fetched(const TableRows &rows);
+    void failed(int generation, const QString &message);
+    void finished(int generation);
+
+private:
+    bool isCancelled(const TableFetchRequest &request) const;
+    void dropReload(const TableFetchRequest &request);
+
+    QAtomicInt m_generation;
+};
+
+#endif // TABLEFETCHER_H
@@ -23,7 +23,17 @@
  */
 
 #include "tablemodel.h"
+#include "tablefetcher.h"
+#include "tableexporter.h"
+#include "editqueue.h"
+#include "tablequery.h"
+#include "indexadvisor.h"
+#include "rowblock.h"
+#include "rowselection.h"
+#include "relationcache.h"
+#include "queryprofiler.h"
 #include "sql.h"
+#include "connectionpool.h"
 
 #include <QSqlDriver>
 #include <QSqlRecord>
@@ -31,13 +41,35 @@
 #include <QSqlQuery>
 #include <QSqlError>
 #include <QSqlIndex>
+#include <QSet>
+#include <QCache>
 #include <QDateTime>
-#include <QItemSelectionModel>
+#include <QThread>
+#include <QTimer>
 #include <QUrl>
 #include <QLoggingCategory>
 
+#include <algorithm>
+
 Q_LOGGING_CATEGORY(lcTableModel, "app.TableModel")
 
+// writes wait for the writer lock as long as for a busy database
+static const int WRITER_TIMEOUT = 5000;
+
+/**
+ * @brief a window of rows fetched by keyset pagination.
+ * a page remembers the cursor it starts after and how many rows it holds,
+ * so its rows can be dropped from memory and read back later.
+ */
+struct TablePage
+{
+    TableCursor after;
+    int count = 0;
+    RowBlock rows;
+    quint64 lastUsed = 0;
+    int requested = -1;         // generation it is being read back in, a new one drops the read
+};
+
 class TableModelPrivate
 {
     Q_DECLARE_PUBLIC(TableModel)
@@ -46,20 +78,168 @@ public:
     void handleDatanaseChanged();
     void handleTableChanged();
 
+    bool keyset() const { return paged || async; }
+    QString escapedField(const QString &name) const;
+    bool resolveKeyField();
+    QString filterClause(QVariantList *values) const;
+    void resolveTables() const;
+    QString searchTable() const;
+    QStringList searchFields() const;
+    QString searchClause(QVariantList *values) const;
+    QString scopeClause() const;
+    QString whereClause(QVariantList *values) const;
+    QStringList indexColumns() const;
+    void buildQuery();
+    bool loadRows(const TableCursor &after, int limit, RowBlock *rows) const;
+    void clearPages();
+    int fetchPage(bool notify);
+    void appendPage(const TableCursor &after, const RowBlock &rows, bool notify);
+    int pageOf(int row) const;
+    RowBlock *blockAt(int row, int *offset, bool load = true) const;
+    void evictPages(int keep = -1) const;
+    int viewportDistance(int page) const;
+    void prefetch();
+    void requestPage(int page);
+    void fillPage(const TableRows &batch);
+    void updateOffsets(int from);
+    QVariant value(int row, int column) const;
+    QVariant lazyValue(qint64 key, int column) const;
+    bool updateValue(int row, int column, const QVariant &value);
+    void removePagedRows(int first, int last);
+
+    QVariant cell(int row, int column) const;
+    QVariant display(int column, const QVariant &value) const;
+    QVariant keyOf(int row) const;
+    bool isTrashed(int row, int column) const;
+    bool execForKeys(QSqlQuery &query, const QString &statement, const QVariantList &keys,
+                     const QVariantList &values = QVariantList());
+    int removeRowList(const RowSelection &rows);
+    int recoverRowList(const RowSelection &rows);
+    void announceSelection(int first, int last);
+    int insertRecord(const QSqlRecord &record, bool *ok);
+    bool insertRecords(QVector<QSqlRecord> &records);
+    void appendInserted(int count);
+
+    EditQueue *ensureEdits();
+    void handleEditsFailed(const QVector<EditQueue::Edit> &failed, const QString &error);
+    void reloadRow(qint64 key);
+
+    TableFetcher *ensureFetcher();
+    void startFetch(bool stream);
+    void handleFetched(const TableRows &batch);
+    void handleFetchFinished(int generation);
+    void setLoading(bool value);
+    void updateProgress();
+    void estimateTotal();
+    void requestCount();
+    void setTotal(int total, bool exact);
+    void adjustTotal(int delta);
+
+    void markSync();
+    void startSync();
+    void pollChanges();
+    bool syncChanges();
+    int pageFor(const TableCursor &cursor) const;
+    int findRow(qint64 key, bool *known) const;
+    bool applyChange(const RowBlock &row, bool matched);
+    bool insertChanged(const RowBlock &row);
+
     QString databaseName;
     QString tableName;
-    QString errorString;
+    mutable QString errorString;
     bool completed = false;
-    QItemSelectionModel *selectionModel = nullptr;
+    RowSelection selection;
     mutable QHash<int, QByteArray> roles;
+
+    // keyset pagination
+    bool paged = false;
+    int pageSize = 256;
+    int maxPages = 64;
+    QString keyField;
+    int keyColumn = -1;
+    RowBlock::Layout layout;
+    QStringList internedFields;
+    QStringList lazyFields;
+    mutable QCache<qint64, QVector<QVariant>> lazyRows { 1024 };
+    TableQuery query;
+    TableCursor lastCursor;
+    bool atEnd = true;
+    int pagedRows = 0;
+    mutable QVector<TablePage> pages;
+    QVector<int> pageOffsets;
+    mutable int residentPages = 0;
+    mutable quint64 tick = 0;
+
+    // viewport read-ahead
+    int viewportFirst = -1;
+    int viewportLast = -1;
+    int direction = 0;          // 1 down, -1 up
+    qreal velocity = 0;         // rows per second
+    int prefetchPages = 2;
+
+    // sorting and filtering
+    int sortColumn = -1;
+    Qt::SortOrder sortOrder = Qt::AscendingOrder;
+    QVariantMap filters;
+    QString search;
+    TableModel::Scope scope = TableModel::AllScope;
+    bool filtering = false;
+
+    // the table and its companions, looked up once per table and schema
+    mutable QString tablesOf;           // database and table they were looked up for
+    mutable qint64 tablesSchema = -1;   // PRAGMA schema_version of the lookup
+    mutable bool tableExists = false;
+    mutable QString searchIndex;        // <table>_fts
+    mutable bool changeLog = false;     // <table>_changes
+    bool autoIndex = true;
+    mutable RelationCache relations;
+    TableExporter *exporter = nullptr;
+
+    // write-behind edits
+    bool writeBehind = false;
+    int flushInterval = 500;
+    int flushThreshold = 1000;
+    EditQueue *edits = nullptr;
+    StorageProfile::Profile storageProfile = StorageProfile::Default;
+    bool ownProfile = false;    // false: the profile set for the database in the pool
+    IndexAdvisor advisor;
+
+    // asynchronous select
+    bool async = false;
+    bool loading = false;
+    qreal progress = 0;
+    int generation = 0;
+    int totalRows = -1;
+    bool totalExact = false;    // counted, otherwise estimated
+    QThread *fetcherThread = nullptr;
+    TableFetcher *fetcher = nullptr;
+
+    // change tracking
+    QTimer *syncTimer = nullptr;
+    int syncInterval = 1000;
+    qint64 dataVersion = -1;
+    qint64 syncedSeq = -1;      // last seq of the change log applied
+
     TableModel *q_ptr = nullptr;
 };
 
+/**
+ * @brief reopen the connection of the model on databaseName
+ * with the storage profile of the model
+ */
 void TableModelPrivate::handleDatanaseChanged()
 {
     Q_Q(TableModel);
-    q->database().setDatabaseName(databaseName);
-    q->database().open();
+    QSqlDatabase db = q->database();
+    StatementCache::local()->invalidate(db);
+    db.close();
+    db.setDatabaseName(databaseName);
+    if(ownProfile)
+        ConnectionPool::instance()->setStorageProfile(databaseName, storageProfile);
+    else
+        storageProfile = ConnectionPool::instance()->storageProfile(databaseName);
+    // configured like a connection of the pool, not only by the profile
+    ConnectionPool::instance()->open(db);
 }
 
 void TableModelPrivate::handleTableChanged()
@@ -67,238 +247,3161 @@ void TableModelPrivate::handleTableChanged()
 
 }
 
+QString TableModelPrivate::escapedField(const QString &name) const
+{
+    Q_Q(const TableModel);
+    return q->database().driver()->escapeIdentifier(name, QSqlDriver::FieldName);
+}
+
 /**
- * @brief TableModel::TableModel
- * @param parent
+ * @brief keyset pagination needs a single integer primary key,
+ * the storage of fetched rows follows the fields of the table
+ * @return
  */
-TableModel::TableModel(QObject *parent)
-    : QSqlRelationalTableModel(parent, Sql::database())
-    , d_ptr(new TableModelPrivate())
+bool TableModelPrivate::resolveKeyField()
 {
-    Q_D(TableModel);
-    d->q_ptr = this;
+    Q_Q(TableModel);
+    keyField.clear();
+    keyColumn = -1;
+    layout = RowBlock::layout(q->record(), internedFields);
+    QSqlIndex index = q->primaryKey();
+    if(index.count() != 1)
+        return false;
 
-    setEditStrategy(OnFieldChange);
+    QVariant::Type type = index.field(0).type();
+    if(type != QVariant::Int && type != QVariant::LongLong
+            && type != QVariant::UInt && type != QVariant::ULongLong)
+        return false;
+
+    keyField = index.fieldName(0);
+    keyColumn = q->record().indexOf(keyField);
+    return keyColumn != -1;
 }
 
-TableModel::~TableModel()
+/**
+ * @brief the WHERE condition of the filter map, fields are ANDed:
+ * { "author": "Scott Meyers" }              author = ?
+ * { "deleted_at": null }                    deleted_at IS NULL
+ * { "state": [0, 3] }                       state IN (?, ?)
+ * { "price": { "op": ">=", "value": 5000 } }  price >= ?
+ * @param values receives the bound values, the values are written
+ * into the condition as literals when it is nullptr
+ * @return
+ */
+QString TableModelPrivate::filterClause(QVariantList *values) const
 {
+    Q_Q(const TableModel);
+    static const QStringList operators = { "=", "!=", "<>", "<", "<=", ">", ">=", "like" };
+
+    QSqlDriver *driver = q->database().driver();
+    const QSqlRecord rec = q->record();
+    auto placeholder = [&](const QString &name, const QVariant &value) -> QString {
+        if(values)
+        {
+            *values << value;
+            return QStringLiteral("?");
+        }
+        QSqlField field = rec.field(name);
+        field.setValue(value);
+        return driver->formatValue(field);
+    };
+
+    QStringList conditions;
+    for (auto it = filters.constBegin(); it != filters.constEnd(); ++it)
+    {
+        if(rec.indexOf(it.key()) == -1)
+        {
+            qWarning(lcTableModel) << "Filter on unknown field" << it.key() << "ignored";
+            continue;
+        }
+
+        const QString field = escapedField(it.key());
+        QString op = "=";
+        QVariant value = it.value();
+        if(value.type() == QVariant::Map)
+        {
+            const QVariantMap condition = value.toMap();
+            op = condition.value("op", "=").toString().toLower();
+            value = condition.value("value");
+            if(!operators.contains(op))
+            {
+                qWarning(lcTableModel) << "Filter operator" << op << "on" << it.key() << "ignored";
+                continue;
+            }
+        }
+
+        if(value.type() == QVariant::List || value.type() == QVariant::StringList)
+        {
+            const QVariantList list = value.toList();
+            if(list.isEmpty())
+            {
+                conditions << QStringLiteral("0");
+                continue;
+            }
+
+            QStringList marks;
+            for (const QVariant &item : list)
+                marks << placeholder(it.key(), item);
+            conditions << QString("%1 %2 (%3)")
+                          .arg(field, op == "!=" || op == "<>" ? "NOT IN" : "IN", marks.join(", "));
+        }
+        else if(value.isNull())
+        {
+            conditions << QString("%1 %2").arg(field, op == "!=" || op == "<>" ? "IS NOT NULL" : "IS NULL");
+        }
+        else
+        {
+            conditions << QString("%1 %2 %3").arg(field, op.toUpper(), placeholder(it.key(), value));
+        }
+    }
 
+    return conditions.join(" AND ");
 }
 
-void TableModel::classBegin()
+/**
+ * @brief look the table, its full-text index and its deletion log up.
+ * QSqlDatabase::tables() reads all of sqlite_master, so it is only asked
+ * again after the table, the database or the schema changed: schema_version
+ * counts the schema changes and is cheap to ask for.
+ */
+void TableModelPrivate::resolveTables() const
 {
-    qDebug(lcTableModel) << "TableModel::classBegin";
+    Q_Q(const TableModel);
+    QSqlDatabase db = q->database();
+    qint64 schema = -1;
+    QSqlQuery sqlQuery = Sql::statement("PRAGMA schema_version", db);
+    if(sqlQuery.exec() && sqlQuery.next())
+        schema = sqlQuery.value(0).toLongLong();
+    sqlQuery.finish();
+
+    const QString table = q->tableName();
+    const QString of = db.databaseName() + '\n' + table;
+    if(schema != -1 && schema == tablesSchema && of == tablesOf)
+        return;
+
+    const QStringList tables = db.tables();
+    tablesOf = of;
+    tablesSchema = schema;
+    tableExists = tables.contains(table);
+    searchIndex = tables.contains(table + "_fts") ? table + "_fts" : QString();
+    changeLog = tables.contains(table + "_changes");
 }
 
-void TableModel::componentComplete()
+/**
+ * @brief the full-text index of the table, named <table>_fts
+ * (see migrations/003_books_fts.sql), empty if there is none
+ * @return
+ */
+QString TableModelPrivate::searchTable() const
 {
-    Q_D(TableModel);
-    qDebug(lcTableModel) << "TableModel::componentComplete";
-    d->completed = true;
+    resolveTables();
+    return searchIndex;
+}
 
-    // connect signals slots
-    // ...
+/**
+ * @brief the fields a search looks in: the columns of the full-text index,
+ * or every string field of a table without one
+ * @return
+ */
+QStringList TableModelPrivate::searchFields() const
+{
+    Q_Q(const TableModel);
+    QStringList fields;
+    const QString table = searchTable();
+    const QSqlRecord rec = table.isEmpty() ? q->record() : q->database().record(table);
+    for (int i = 0; i < rec.count(); ++i)
+    {
+        if(!table.isEmpty() || rec.field(i).type() == QVariant::String)
+            fields << rec.fieldName(i);
+    }
+    return fields;
+}
 
-    this->database().close();
-    this->database().setDatabaseName(d->databaseName);
-    this->database().open();
-    QSqlRelationalTableModel::setTable(d->tableName);
+/**
+ * @brief the condition of the search text. every word has to occur in a
+ * searched field. the trigram tokenizer only indexes words of three or more
+ * characters, shorter words fall back to LIKE over the table.
+ * @param values receives the bound values, or nullptr for literals
+ * @return
+ */
+QString TableModelPrivate::searchClause(QVariantList *values) const
+{
+    Q_Q(const TableModel);
+    static const int trigram = 3;
+    const QString text = search.simplified();
+    if(text.isEmpty())
+        return QString();
 
-    qDebug() << "database:" << this->database().databaseName()
-             << ", table:"  << this->tableName()
-             << ", connection name:"  << this->database().connectionName();
+    const QStringList words = text.split(' ');
 
-    this->select();
+    QSqlDriver *driver = q->database().driver();
+    auto placeholder = [&](const QString &value) -> QString {
+        if(values)
+        {
+            *values << value;
+            return QStringLiteral("?");
+        }
+        QSqlField field(QString(), QVariant::String);
+        field.setValue(value);
+        return driver->formatValue(field);
+    };
+
+    const QString table = driver->escapeIdentifier(q->tableName(), QSqlDriver::TableName);
+    const QString ftsTable = searchTable();
+    bool indexed = !ftsTable.isEmpty();
+    for (const QString &word : words)
+        indexed = indexed && word.length() >= trigram;
+
+    if(indexed)
+    {
+        // each word is a phrase, so the query syntax of fts5 is not interpreted
+        QStringList phrases;
+        for (QString word : words)
+            phrases << '"' + word.replace('"', "\"\"") + '"';
+
+        const QString fts = driver->escapeIdentifier(ftsTable, QSqlDriver::TableName);
+        return QString("%1.rowid IN (SELECT rowid FROM %2 WHERE %2 MATCH %3)")
+                .arg(table, fts, placeholder(phrases.join(' ')));
+    }
+
+    const QStringList fields = searchFields();
+    if(fields.isEmpty())
+        return QString();
+
+    QStringList conditions;
+    for (QString word : words)
+    {
+        word.replace('\\', "\\\\").replace('%', "\\%").replace('_', "\\_");
+        QStringList matches;
+        for (const QString &field : fields)
+            matches << QString("%1.%2 LIKE %3 ESCAPE '\\'")
+                       .arg(table, escapedField(field), placeholder('%' + word + '%'));
+        conditions << '(' + matches.join(" OR ") + ')';
+    }
+    return conditions.join(" AND ");
 }
 
-QHash<int, QByteArray> TableModel::roleNames() const
+/**
+ * @brief the condition of the scope, empty for all rows
+ * or a table without soft delete
+ * @return
+ */
+QString TableModelPrivate::scopeClause() const
 {
-    Q_D(const TableModel);
-    QHash<int, QByteArray> roles;
+    Q_Q(const TableModel);
+    if(scope == TableModel::AllScope || q->record().indexOf("deleted_at") == -1)
+        return QString();
 
-    // for checked
-    roles.insert(Qt::CheckStateRole, QByteArrayLiteral("checkState"));
+    return escapedField("deleted_at") + (scope == TableModel::ActiveScope ? " IS NULL" : " IS NOT NULL");
+}
 
-    // database table fileds
-    QSqlRecord record = this->record();
-    for (int i = 0; i < record.count(); ++i)
+/**
+ * @brief the scope, the filter and the search, values are bound in that order.
+ * the scope comes first and has the form of the partial indexes of
+ * Migration::createSoftDeleteIndexes(), so sqlite can use them.
+ * @param values
+ * @return
+ */
+QString TableModelPrivate::whereClause(QVariantList *values) const
+{
+    QStringList conditions;
+    const QString scoped = scopeClause();
+    if(!scoped.isEmpty())
+        conditions << scoped;
+
+    const QString filter = filterClause(values);
+    if(!filter.isEmpty())
+        conditions << filter;
+
+    const QString match = searchClause(values);
+    if(!match.isEmpty())
+        conditions << match;
+
+    return conditions.join(" AND ");
+}
+
+/**
+ * @brief the columns an index for the current sort and filter would have:
+ * equality filters first, then the sort column or else a range filter.
+ * @return
+ */
+QStringList TableModelPrivate::indexColumns() const
+{
+    Q_Q(const TableModel);
+    const QSqlRecord rec = q->record();
+    QStringList columns;
+    QString range;
+    for (auto it = filters.constBegin(); it != filters.constEnd(); ++it)
     {
-        roles.insert(Qt::UserRole + 1 + i, record.fieldName(i).toUtf8());
+        if(rec.indexOf(it.key()) == -1)
+            continue;
+
+        QString op = "=";
+        if(it.value().type() == QVariant::Map)
+            op = it.value().toMap().value("op", "=").toString();
+
+        if(op == "=")
+            columns << it.key();
+        else if(range.isEmpty() && op != "!=" && op != "<>")
+            range = it.key();
     }
 
-    d->roles = roles;
+    // indexes of sqlite end with the rowid, ordering by it needs no column
+    const QString sortField = rec.fieldName(sortColumn);
+    const QSqlIndex primaryKey = q->primaryKey();
+    if(!sortField.isEmpty() && (primaryKey.count() != 1 || sortField != primaryKey.fieldName(0)))
+        columns << sortField;
+    else if(!range.isEmpty())
+        columns << range;
 
-    return roles;
+    columns.removeDuplicates();
+    return columns;
 }
 
-bool TableModel::setData(const QModelIndex &index, const QVariant &value, int role)
+/**
+ * @brief the keyset statements for the current table, sort and filter
+ */
+void TableModelPrivate::buildQuery()
 {
-    Q_D(TableModel);
-    if(!index.isValid())
+    Q_Q(TableModel);
+    const QSqlRecord rec = q->record();
+    query = TableQuery();
+    query.table = q->database().driver()->escapeIdentifier(q->tableName(), QSqlDriver::TableName);
+    for (int i = 0; i < rec.count(); ++i)
+        query.fields << escapedField(rec.fieldName(i));
+
+    query.keyField = escapedField(keyField);
+    query.keyColumn = keyColumn;
+    query.order = sortOrder;
+    if(sortColumn >= 0 && sortColumn < rec.count() && sortColumn != keyColumn)
+    {
+        query.sortField = escapedField(rec.fieldName(sortColumn));
+        query.sortColumn = sortColumn;
+    }
+    query.where = whereClause(&query.whereValues);
+
+    // the cursor needs the key and the sort value of every row
+    for (const QString &field : lazyFields)
+    {
+        const int column = rec.indexOf(field);
+        if(column != -1 && column != keyColumn && column != query.sortColumn)
+            query.lazyColumns.insert(column);
+    }
+    lazyRows.clear();
+
+    if(edits)
+    {
+        EditQueue::Target target;
+        target.databaseName = databaseName;
+        target.table = query.table;
+        target.keyField = query.keyField;
+        target.fields = query.fields;
+        edits->setTarget(target);
+    }
+}
+
+bool TableModelPrivate::loadRows(const TableCursor &after, int limit, RowBlock *rows) const
+{
+    Q_Q(const TableModel);
+    QSqlQuery sqlQuery = Sql::statement(query.pageStatement(after), q->database());
+    for (const QVariant &value : query.pageValues(after, limit))
+        sqlQuery.addBindValue(value);
+    if(!QueryProfiler::exec(sqlQuery, "model"))
+    {
+        errorString = "Read page error " + sqlQuery.lastError().text();
+        qWarning(lcTableModel) << errorString;
         return false;
+    }
 
-    if(role < Qt::UserRole)
+    *rows = RowBlock(layout);
+    rows->reserve(limit);
+    while (sqlQuery.next())
+        rows->append(sqlQuery);
+
+    return true;
+}
+
+void TableModelPrivate::clearPages()
+{
+    pages.clear();
+    pageOffsets.clear();
+    pagedRows = 0;
+    residentPages = 0;
+    lastCursor = TableCursor();
+    atEnd = false;
+}
+
+/**
+ * @brief read the page following the last fetched row
+ * @param notify announce the new rows to views
+ * @return the number of fetched rows, or -1 on error
+ */
+int TableModelPrivate::fetchPage(bool notify)
+{
+    RowBlock rows;
+    if(!loadRows(lastCursor, pageSize, &rows))
     {
-        if(role == Qt::CheckStateRole)
+        atEnd = true;
+        return -1;
+    }
+
+    if(rows.rowCount() < pageSize)
+        atEnd = true;
+
+    appendPage(lastCursor, rows, notify);
+    if(atEnd)
+        setTotal(pagedRows, true);
+    return rows.rowCount();
+}
+
+void TableModelPrivate::appendPage(const TableCursor &after, const RowBlock &rows, bool notify)
+{
+    Q_Q(TableModel);
+    const int count = rows.rowCount();
+    if(count == 0)
+        return;
+
+    TablePage page;
+    page.after = after;
+    page.count = count;
+    page.rows = rows;
+    page.lastUsed = ++tick;
+    lastCursor = query.cursor(rows, count - 1);
+
+    if(notify)
+        q->beginInsertRows(QModelIndex(), pagedRows, pagedRows + count - 1);
+
+    pages.append(page);
+    pageOffsets.append(pagedRows);
+    pagedRows += count;
+    ++residentPages;
+    evictPages(pages.count() - 1);
+
+    if(notify)
+        q->endInsertRows();
+}
+
+int TableModelPrivate::pageOf(int row) const
+{
+    if(row < 0 || row >= pagedRows)
+        return -1;
+
+    auto it = std::upper_bound(pageOffsets.constBegin(), pageOffsets.constEnd(), row);
+    return int(it - pageOffsets.constBegin()) - 1;
+}
+
+/**
+ * @brief the rows of the page holding a row, read back if the page was evicted
+ * @param row
+ * @param offset the position of the row in the block
+ * @param load read an evicted page back, otherwise return nullptr for it
+ * @return nullptr if the row is not available
+ */
+RowBlock *TableModelPrivate::blockAt(int row, int *offset, bool load) const
+{
+    int index = pageOf(row);
+    if(index < 0)
+        return nullptr;
+
+    TablePage &page = pages[index];
+    if(page.rows.isEmpty())
+    {
+        if(!load)
+            return nullptr;
+
+        if(!loadRows(page.after, page.count, &page.rows) || page.rows.isEmpty())
+            return nullptr;
+        ++residentPages;
+        page.lastUsed = ++tick;
+        evictPages(index);
+    }
+    page.lastUsed = ++tick;
+
+    *offset = row - pageOffsets.at(index);
+    if(*offset >= page.rows.rowCount())
+        return nullptr;
+
+    return &page.rows;
+}
+
+/**
+ * @brief drop pages until at most maxPages are resident: the page farthest
+ * from the viewport first, then the least recently used. a streamed select
+ * keeps every row like QSqlTableModel::select() does. the page at keep was
+ * just read or changed and is never the victim, so callers can keep using it.
+ */
+void TableModelPrivate::evictPages(int keep) const
+{
+    while (paged && residentPages > maxPages)
+    {
+        int victim = -1;
+        int victimDistance = 0;
+        for (int i = 0; i < pages.count(); ++i)
         {
-            QItemSelectionModel::SelectionFlag flag = value.toBool()
-                    ? QItemSelectionModel::Select
-                    : QItemSelectionModel::Deselect;
-            d->selectionModel->select(index, flag);
-            emit selectionChanged();
-            emit dataChanged(index, index, {role});
-            return true;
+            const TablePage &page = pages.at(i);
+            if(page.rows.isEmpty() || i == keep)
+                continue;
+
+            const int distance = viewportDistance(i);
+            if(victim == -1 || distance > victimDistance
+                    || (distance == victimDistance && page.lastUsed < pages.at(victim).lastUsed))
+            {
+                victim = i;
+                victimDistance = distance;
+            }
         }
 
-        return QSqlRelationalTableModel::setData(index, value, role);
+        if(victim == -1)
+            break;
+
+        pages[victim].rows = RowBlock();
+        --residentPages;
+    }
+}
+
+/**
+ * @brief how far a page is from the rows the view shows, in pages.
+ * pages behind the direction of travel count twice.
+ * @param page
+ * @return 0 for pages in the viewport, or without a viewport
+ */
+int TableModelPrivate::viewportDistance(int page) const
+{
+    if(viewportLast < 0)
+        return 0;
+
+    const int firstPage = pageOf(qMin(viewportFirst, pagedRows - 1));
+    const int lastPage = pageOf(qMin(viewportLast, pagedRows - 1));
+    if(firstPage < 0 || lastPage < 0)
+        return 0;
+
+    if(page < firstPage)
+        return (firstPage - page) * (direction > 0 ? 2 : 1);
+    if(page > lastPage)
+        return (page - lastPage) * (direction < 0 ? 2 : 1);
+    return 0;
+}
+
+/**
+ * @brief read the pages ahead of the viewport on the fetcher thread: evicted
+ * pages are read back, past the fetched rows the next page is fetched.
+ * the faster the view moves, the further ahead.
+ */
+void TableModelPrivate::prefetch()
+{
+    // the rows a flick passes in half a second
+    static const qreal lookahead = 0.5;
+
+    if(!paged || viewportLast < 0)
+        return;
+
+    const int visible = viewportLast - viewportFirst + 1;
+    const int ahead = qMax(visible, pageSize) * prefetchPages + qRound(qAbs(velocity) * lookahead);
+    int first = viewportFirst, last = viewportLast;
+    if(direction < 0)
+        first -= ahead;
+    else
+        last += ahead;
+
+    // a window larger than the resident pages would evict itself
+    int budget = qMax(1, maxPages - (visible + pageSize - 1) / pageSize - 1);
+    const int firstPage = pageOf(qBound(0, first, pagedRows - 1));
+    const int lastPage = pageOf(qBound(0, last, pagedRows - 1));
+    if(firstPage >= 0 && lastPage >= 0)
+    {
+        const int step = direction < 0 ? -1 : 1;
+        const int from = direction < 0 ? lastPage : firstPage;
+        const int to = direction < 0 ? firstPage : lastPage;
+        for (int i = from; i != to + step && budget > 0; i += step)
+        {
+            if(pages.at(i).rows.isEmpty() && pages.at(i).requested != generation)
+            {
+                requestPage(i);
+                --budget;
+            }
+        }
+    }
+
+    if(direction >= 0 && last >= pagedRows && !atEnd && !loading)
+        startFetch(false);
+}
+
+/**
+ * @brief read an evicted page back on the fetcher thread, see fillPage()
+ * @param page
+ */
+void TableModelPrivate::requestPage(int page)
+{
+    Q_Q(TableModel);
+    TablePage &target = pages[page];
+    target.requested = generation;
+
+    TableFetchRequest request;
+    request.generation = generation;
+    request.databaseName = q->database().databaseName();
+    request.query = query;
+    request.layout = layout;
+    request.after = target.after;
+    request.batchSize = target.count;
+    request.reload = true;
+
+    TableFetcher *worker = ensureFetcher();
+    worker->setGeneration(generation);
+    QMetaObject::invokeMethod(worker, [worker, request]() {
+        worker->fetch(request);
+    }, Qt::QueuedConnection);
+}
+
+/**
+ * @brief put the rows read back into their page. a page that was read in
+ * the meantime, or whose rows changed in number, is left as it is.
+ * @param batch
+ */
+void TableModelPrivate::fillPage(const TableRows &batch)
+{
+    int low = 0, high = pages.count();
+    while (low < high)
+    {
+        const int middle = (low + high) / 2;
+        if(query.compare(pages.at(middle).after, batch.after) < 0)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    if(low >= pages.count() || pages.at(low).after != batch.after)
+        return;
+
+    TablePage &page = pages[low];
+    page.requested = -1;
+    if(!page.rows.isEmpty() || page.count != batch.rows.rowCount())
+        return;
+
+    page.rows = batch.rows;
+    page.lastUsed = ++tick;
+    ++residentPages;
+    evictPages(low);
+}
+
+void TableModelPrivate::updateOffsets(int from)
+{
+    int offset = from > 0 ? pageOffsets.at(from - 1) + pages.at(from - 1).count : 0;
+    for (int i = from; i < pages.count(); ++i)
+    {
+        pageOffsets[i] = offset;
+        offset += pages.at(i).count;
+    }
+    pagedRows = offset;
+}
+
+QVariant TableModelPrivate::value(int row, int column) const
+{
+    int offset = 0;
+    const RowBlock *block = blockAt(row, &offset);
+    if(!block)
+        return QVariant();
+
+    // an edit not yet written is newer than a page read again from the table
+    if(edits && !edits->isEmpty())
+    {
+        bool found = false;
+        const QVariant edited = edits->value(block->integer(offset, keyColumn), column, &found);
+        if(found)
+            return edited;
     }
 
-    int column = role - Qt::UserRole - 1;
-    QModelIndex modelIndex = createIndex(index.row(), column);
-    return QSqlRelationalTableModel::setData(modelIndex, value, Qt::EditRole);
+    if(query.lazyColumns.contains(column))
+        return lazyValue(block->integer(offset, keyColumn), column);
+
+    return block->value(offset, column);
+}
+
+/**
+ * @brief a lazy column of a row, the lazy columns of the row are read
+ * together when one of them is asked for and kept in an LRU cache
+ * @param key
+ * @param column
+ * @return
+ */
+QVariant TableModelPrivate::lazyValue(qint64 key, int column) const
+{
+    Q_Q(const TableModel);
+    if(const QVector<QVariant> *values = lazyRows.object(key))
+        return values->value(column);
+
+    QList<int> columns = query.lazyColumns.values();
+    std::sort(columns.begin(), columns.end());
+    QStringList fields;
+    for (int lazyColumn : columns)
+        fields << query.fields.at(lazyColumn);
+
+    QSqlQuery sqlQuery = Sql::statement(QString("SELECT %1 FROM %2 WHERE %3 = ?")
+                                        .arg(fields.join(", "), query.table, query.keyField), q->database());
+    sqlQuery.addBindValue(key);
+    if(!QueryProfiler::exec(sqlQuery, "model") || !sqlQuery.next())
+        return QVariant();
+
+    QVector<QVariant> *values = new QVector<QVariant>(query.fields.count());
+    for (int i = 0; i < columns.count(); ++i)
+        (*values)[columns.at(i)] = sqlQuery.value(i);
+    sqlQuery.finish();
+
+    const QVariant result = values->value(column);
+    lazyRows.insert(key, values);
+    return result;
+}
+
+bool TableModelPrivate::updateValue(int row, int column, const QVariant &value)
+{
+    Q_Q(TableModel);
+    int offset = 0;
+    RowBlock *block = blockAt(row, &offset);
+    if(!block || column < 0 || column >= block->columnCount())
+        return false;
+
+    if(writeBehind)
+    {
+        ensureEdits()->set(block->integer(offset, keyColumn), column, value);
+        block->setValue(offset, column, value);
+        if(QVector<QVariant> *values = lazyRows.object(block->integer(offset, keyColumn)))
+            (*values)[column] = value;
+        QModelIndex modelIndex = q->index(row, column);
+        emit q->dataChanged(modelIndex, modelIndex);
+        return true;
+    }
+
+    WriterLock writer(q->database().databaseName(), WRITER_TIMEOUT);
+    if(!writer.isLocked())
+    {
+        errorString = "Update record error, the database is busy";
+        qWarning(lcTableModel) << errorString;
+        return false;
+    }
+
+    const QString table = q->database().driver()->escapeIdentifier(q->tableName(), QSqlDriver::TableName);
+    QSqlQuery query = Sql::statement(QString("UPDATE %1 SET %2 = ? WHERE %3 = ?")
+                                     .arg(table, escapedField(q->record().fieldName(column)), escapedField(keyField)),
+                                     q->database());
+    query.addBindValue(value);
+    query.addBindValue(block->integer(offset, keyColumn));
+    if(!QueryProfiler::exec(query, "model"))
+    {
+        errorString = "Update record error " + query.lastError().text();
+        qWarning(lcTableModel) << errorString;
+        return false;
+    }
+
+    block->setValue(offset, column, value);
+    if(QVector<QVariant> *values = lazyRows.object(block->integer(offset, keyColumn)))
+        (*values)[column] = value;
+    QModelIndex modelIndex = q->index(row, column);
+    emit q->dataChanged(modelIndex, modelIndex);
+    return true;
+}
+
+/**
+ * @brief drop rows that were deleted from the table, the caller
+ * announces the removal
+ * @param first
+ * @param last
+ */
+void TableModelPrivate::removePagedRows(int first, int last)
+{
+    int index = pageOf(first);
+    if(index < 0)
+        return;
+
+    adjustTotal(first - last - 1);
+
+    int remaining = last - first + 1;
+    int from = index;
+    while (remaining > 0 && index < pages.count())
+    {
+        TablePage &page = pages[index];
+        int offset = qMax(0, first - pageOffsets.at(index));
+        int count = qMin(remaining, page.count - offset);
+        if(!page.rows.isEmpty())
+        {
+            for (int i = count - 1; i >= 0; --i)
+                page.rows.remove(offset + i);
+        }
+        page.count -= count;
+        remaining -= count;
+
+        if(page.count == 0)
+        {
+            if(!page.rows.isEmpty())
+                --residentPages;
+            pages.remove(index);
+            pageOffsets.remove(index);
+            continue;
+        }
+        ++index;
+    }
+    updateOffsets(from);
+}
+
+/**
+ * @brief insert a record into the table.
+ * rows ordered by key only show a new row at the end, once every page
+ * before it has been fetched. a sorted or filtered model has to select
+ * again to find the place of the row, it is looked up by key afterwards.
+ * @param record
+ * @param ok false on error
+ * @return the row of the new record, or -1 if it is not known (yet):
+ * not fetched, or selected on the fetcher thread
+ */
+int TableModelPrivate::insertRecord(const QSqlRecord &record, bool *ok)
+{
+    Q_Q(TableModel);
+    QSqlDriver *driver = q->database().driver();
+    const QString table = driver->escapeIdentifier(q->tableName(), QSqlDriver::TableName);
+    QSqlQuery sqlQuery = Sql::statement(driver->sqlStatement(QSqlDriver::InsertStatement, table, record, true),
+                                        q->database());
+    for (int i = 0; i < record.count(); ++i)
+    {
+        if(record.isGenerated(i))
+            sqlQuery.addBindValue(record.value(i));
+    }
+
+    *ok = false;
+    {
+        WriterLock writer(q->database().databaseName(), WRITER_TIMEOUT);
+        if(!writer.isLocked())
+        {
+            errorString = "Insert record failed, the database is busy";
+            return -1;
+        }
+
+        if(!QueryProfiler::exec(sqlQuery, "model"))
+        {
+            errorString = "Insert record failed " + sqlQuery.lastError().text();
+            return -1;
+        }
+    }
+
+    *ok = true;
+    const QVariant key = sqlQuery.lastInsertId();
+    if(query.isSorted() || !query.where.isEmpty() || query.order == Qt::DescendingOrder)
+    {
+        if(!q->refresh() || loading)
+            return -1;
+
+        bool known = true;
+        return findRow(key.toLongLong(), &known);
+    }
+
+    if(!atEnd)
+    {
+        // the row is past the fetched rows
+        adjustTotal(1);
+        return -1;
+    }
+
+    QSqlQuery rowQuery = Sql::statement(query.rowStatement(), q->database());
+    rowQuery.addBindValue(key);
+    if(!QueryProfiler::exec(rowQuery, "model"))
+    {
+        errorString = "Read record error " + rowQuery.lastError().text();
+        *ok = false;
+        return -1;
+    }
+
+    RowBlock rows(layout);
+    while (rowQuery.next())
+        rows.append(rowQuery);
+    if(rows.isEmpty())
+        return -1;
+
+    int row = pagedRows;
+    q->beginInsertRows(QModelIndex(), row, row);
+    if(pages.isEmpty() || pages.last().count >= pageSize || pages.last().rows.isEmpty())
+    {
+        TablePage page;
+        page.after = lastCursor;
+        page.rows = RowBlock(layout);
+        pages.append(page);
+        pageOffsets.append(pagedRows);
+        ++residentPages;
+    }
+    TablePage &page = pages.last();
+    page.rows.append(rows);
+    page.lastUsed = ++tick;
+    ++page.count;
+    ++pagedRows;
+    lastCursor = query.cursor(rows, 0);
+    evictPages(pages.count() - 1);
+    q->endInsertRows();
+    adjustTotal(1);
+
+    return row;
+}
+
+/**
+ * @brief insert records in one transaction. records with the same fields
+ * share a prepared statement, consecutive records only bind their values.
+ * the generated key of each record is written back into it.
+ * views are told once: one insert at the end of a model ordered by key,
+ * a reset otherwise.
+ * @param records
+ * @return false if no record was inserted
+ */
+bool TableModelPrivate::insertRecords(QVector<QSqlRecord> &records)
+{
+    Q_Q(TableModel);
+    if(records.isEmpty())
+        return true;
+
+    QSqlDatabase db = q->database();
+    QSqlDriver *driver = db.driver();
+    const QString table = driver->escapeIdentifier(q->tableName(), QSqlDriver::TableName);
+    const QSqlIndex primaryKey = q->primaryKey();
+    const QString keyName = primaryKey.count() == 1 ? primaryKey.fieldName(0) : QString();
+
+    WriterLock writer(db.databaseName(), WRITER_TIMEOUT);
+    if(!writer.isLocked())
+    {
+        errorString = "Insert records failed, the database is busy";
+        qWarning(lcTableModel) << errorString;
+        return false;
+    }
+
+    bool transacted = driver->hasFeature(QSqlDriver::Transactions);
+    if(transacted)
+        db.transaction();
+
+    QSqlQuery sqlQuery(db);
+    QString statement;
+    for (QSqlRecord &record : records)
+    {
+        QString sql = driver->sqlStatement(QSqlDriver::InsertStatement, table, record, true);
+        if(sql.isEmpty())
+            sql = QString("INSERT INTO %1 DEFAULT VALUES").arg(table);
+        if(sql != statement)
+        {
+            sqlQuery = Sql::statement(sql, db);
+            statement = sql;
+        }
+
+        for (int i = 0; i < record.count(); ++i)
+        {
+            if(record.isGenerated(i))
+                sqlQuery.addBindValue(record.value(i));
+        }
+
+        if(!QueryProfiler::exec(sqlQuery, "model"))
+        {
+            errorString = "Insert records failed " + sqlQuery.lastError().text();
+            qWarning(lcTableModel) << errorString;
+            if(transacted)
+                db.rollback();
+            return false;
+        }
+
+        if(!keyName.isEmpty() && !record.isGenerated(keyName))
+            record.setValue(keyName, sqlQuery.lastInsertId());
+    }
+
+    if(transacted && !db.commit())
+    {
+        errorString = "Insert records failed " + db.lastError().text();
+        qWarning(lcTableModel) << errorString;
+        db.rollback();
+        return false;
+    }
+
+    if(!keyset())
+    {
+        q->QSqlRelationalTableModel::select();
+        return true;
+    }
+
+    // the place of the rows is known only in key order
+    if(query.isSorted() || query.order == Qt::DescendingOrder)
+    {
+        q->refresh();
+        return true;
+    }
+
+    // not fetched yet, the rows come with the last pages
+    if(atEnd)
+        appendInserted(records.count());
+    else if(query.where.isEmpty())
+        adjustTotal(records.count());
+    else
+        requestCount();
+    return true;
+}
+
+/**
+ * @brief read the rows after the last fetched row and append them
+ * with one insert. the page statement applies the filter, so only the
+ * inserted rows that match it are read.
+ * @param count the number of inserted rows
+ */
+void TableModelPrivate::appendInserted(int count)
+{
+    Q_Q(TableModel);
+    QVector<RowBlock> blocks;
+    TableCursor after = lastCursor;
+    int total = 0;
+    while (total < count)
+    {
+        RowBlock rows;
+        if(!loadRows(after, pageSize, &rows) || rows.isEmpty())
+            break;
+
+        total += rows.rowCount();
+        after = query.cursor(rows, rows.rowCount() - 1);
+        blocks.append(rows);
+        if(rows.rowCount() < pageSize)
+            break;
+    }
+
+    if(total == 0)
+        return;
+
+    q->beginInsertRows(QModelIndex(), pagedRows, pagedRows + total - 1);
+    for (const RowBlock &rows : blocks)
+        appendPage(lastCursor, rows, false);
+    q->endInsertRows();
+    adjustTotal(total);
+}
+
+QVariant TableModelPrivate::cell(int row, int column) const
+{
+    Q_Q(const TableModel);
+    if(keyset())
+        return value(row, column);
+
+    return q->QSqlRelationalTableModel::data(q->index(row, column), Qt::EditRole);
+}
+
+/**
+ * @brief the display text of a foreign key column, see setRelation()
+ * @param column
+ * @param value
+ * @return
+ */
+QVariant TableModelPrivate::display(int column, const QVariant &value) const
+{
+    Q_Q(const TableModel);
+    if(!relations.hasRelation(column))
+        return value;
+
+    return relations.display(q->database(), column, value);
+}
+
+QVariant TableModelPrivate::keyOf(int row) const
+{
+    if(keyset())
+    {
+        int offset = 0;
+        const RowBlock *block = blockAt(row, &offset);
+        return block ? QVariant(block->integer(offset, keyColumn)) : QVariant();
+    }
+
+    return cell(row, keyColumn);
+}
+
+/**
+ * @brief a soft deleted row has a timestamp in its deleted_at field
+ * @param row
+ * @param column the deleted_at field
+ * @return
+ */
+bool TableModelPrivate::isTrashed(int row, int column) const
+{
+    const QString value = cell(row, column).toString();
+    return QDateTime::fromString(value, Qt::ISODate).isValid();
+}
+
+/**
+ * @brief execute a statement for a list of keys, chunk by chunk.
+ * the statement holds '%1' where the placeholders of the IN list go,
+ * the statement of each chunk size comes from the statement cache.
+ * @param query
+ * @param statement
+ * @param keys
+ * @param values bound to the placeholders before the IN list
+ * @return
+ */
+bool TableModelPrivate::execForKeys(QSqlQuery &query, const QString &statement, const QVariantList &keys,
+                                    const QVariantList &values)
+{
+    Q_Q(TableModel);
+    // stays below SQLITE_MAX_VARIABLE_NUMBER of older sqlite versions
+    static const int chunkSize = 500;
+
+    int prepared = -1;
+    for (int i = 0; i < keys.count(); i += chunkSize)
+    {
+        const int count = qMin(chunkSize, keys.count() - i);
+        if(count != prepared)
+        {
+            QStringList marks;
+            marks.reserve(count);
+            for (int j = 0; j < count; ++j)
+                marks << QStringLiteral("?");
+            query = Sql::statement(statement.arg(marks.join(", ")), q->database());
+            prepared = count;
+        }
+
+        for (int j = 0; j < values.count(); ++j)
+            query.bindValue(j, values.at(j));
+        for (int j = 0; j < count; ++j)
+            query.bindValue(values.count() + j, keys.at(i + j));
+
+        if(!QueryProfiler::exec(query, "model"))
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief delete rows with one statement per state inside one transaction:
+ * rows not yet soft deleted get a deleted_at timestamp, rows already
+ * soft deleted (or of tables without deleted_at) are removed for good.
+ * views are told once per contiguous range.
+ * @param rows sorted, unique rows
+ * @return the number of deleted rows, or -1 on error
+ */
+int TableModelPrivate::removeRowList(const RowSelection &rows)
+{
+    Q_Q(TableModel);
+    if(rows.isEmpty())
+        return 0;
+
+    const int softDeleteColumn = q->fieldIndex("deleted_at");
+    QVariantList softKeys, hardKeys;
+    RowSelection softRows, hardRows;
+    for (int row : rows)
+    {
+        const QVariant key = keyOf(row);
+        if(!key.isValid())
+            continue;
+
+        if(softDeleteColumn != -1 && !isTrashed(row, softDeleteColumn))
+        {
+            softKeys << key;
+            softRows.select(row, row);
+        }
+        else
+        {
+            hardKeys << key;
+            hardRows.select(row, row);
+        }
+    }
+
+    QSqlDatabase db = q->database();
+    const QString table = db.driver()->escapeIdentifier(q->tableName(), QSqlDriver::TableName);
+    const QString key = escapedField(keyField);
+    const QString timestamp = QDateTime::currentDateTime().toString(Qt::ISODate);
+    WriterLock writer(db.databaseName(), WRITER_TIMEOUT);
+    if(!writer.isLocked())
+    {
+        errorString = "Delete records error, the database is busy";
+        qWarning(lcTableModel) << errorString;
+        return -1;
+    }
+
+    bool transacted = db.driver()->hasFeature(QSqlDriver::Transactions);
+    if(transacted)
+        db.transaction();
+
+    QSqlQuery query(db);
+    bool ok = execForKeys(query, QString("UPDATE %1 SET %2 = ? WHERE %3 IN (%4)")
+                          .arg(table, escapedField("deleted_at"), key, "%1"), softKeys, { timestamp })
+            && execForKeys(query, QString("DELETE FROM %1 WHERE %2 IN (%3)")
+                           .arg(table, key, "%1"), hardKeys);
+    if(!ok)
+    {
+        errorString = "Delete records error " + query.lastError().text();
+        qWarning(lcTableModel) << errorString;
+        if(transacted)
+            db.rollback();
+        return -1;
+    }
+
+    if(transacted && !db.commit())
+    {
+        errorString = "Delete records commit error " + db.lastError().text();
+        qWarning(lcTableModel) << errorString;
+        db.rollback();
+        return -1;
+    }
+
+    if(!keyset())
+    {
+        // the rows cached by QSqlTableModel are stale now
+        q->QSqlRelationalTableModel::select();
+        return softRows.count() + hardRows.count();
+    }
+
+    const int removed = softRows.count() + hardRows.count();
+    if(scope == TableModel::ActiveScope)
+    {
+        // trashed rows leave the active scope
+        for (const RowSelection::Range &range : softRows.ranges())
+            hardRows.select(range.first, range.last);
+        softRows.clear();
+    }
+
+    for (const RowSelection::Range &range : softRows.ranges())
+    {
+        for (int row = range.first; row <= range.last; ++row)
+        {
+            int offset = 0;
+            if(RowBlock *block = blockAt(row, &offset, false))
+                block->setValue(offset, softDeleteColumn, timestamp);
+        }
+        emit q->dataChanged(q->index(range.first, softDeleteColumn),
+                            q->index(range.last, softDeleteColumn));
+    }
+
+    const QVector<RowSelection::Range> ranges = hardRows.ranges();
+    for (int i = ranges.count() - 1; i >= 0; --i)
+    {
+        q->beginRemoveRows(QModelIndex(), ranges.at(i).first, ranges.at(i).last);
+        removePagedRows(ranges.at(i).first, ranges.at(i).last);
+        q->endRemoveRows();
+    }
+
+    return removed;
+}
+
+/**
+ * @brief clear deleted_at of soft deleted rows with one statement
+ * @param rows sorted, unique rows
+ * @return the number of recovered rows, or -1 on error
+ */
+int TableModelPrivate::recoverRowList(const RowSelection &rows)
+{
+    Q_Q(TableModel);
+    const int softDeleteColumn = q->fieldIndex("deleted_at");
+    if(softDeleteColumn == -1 || rows.isEmpty())
+        return 0;
+
+    QVariantList keys;
+    RowSelection trashedRows;
+    for (int row : rows)
+    {
+        const QVariant key = keyOf(row);
+        if(key.isValid() && isTrashed(row, softDeleteColumn))
+        {
+            keys << key;
+            trashedRows.select(row, row);
+        }
+    }
+
+    if(keys.isEmpty())
+        return 0;
+
+    QSqlDatabase db = q->database();
+    const QString table = db.driver()->escapeIdentifier(q->tableName(), QSqlDriver::TableName);
+    WriterLock writer(db.databaseName(), WRITER_TIMEOUT);
+    if(!writer.isLocked())
+    {
+        errorString = "Recover records error, the database is busy";
+        qWarning(lcTableModel) << errorString;
+        return -1;
+    }
+
+    bool transacted = db.driver()->hasFeature(QSqlDriver::Transactions);
+    if(transacted)
+        db.transaction();
+
+    QSqlQuery query(db);
+    if(!execForKeys(query, QString("UPDATE %1 SET %2 = NULL WHERE %3 IN (%4)")
+                    .arg(table, escapedField("deleted_at"), escapedField(keyField), "%1"), keys))
+    {
+        errorString = "Recover records error " + query.lastError().text();
+        qWarning(lcTableModel) << errorString;
+        if(transacted)
+            db.rollback();
+        return -1;
+    }
+
+    if(transacted && !db.commit())
+    {
+        errorString = "Recover records commit error " + db.lastError().text();
+        qWarning(lcTableModel) << errorString;
+        db.rollback();
+        return -1;
+    }
+
+    if(!keyset())
+    {
+        q->QSqlRelationalTableModel::select();
+        return trashedRows.count();
+    }
+
+    if(scope == TableModel::TrashedScope)
+    {
+        // recovered rows leave the trash
+        const QVector<RowSelection::Range> ranges = trashedRows.ranges();
+        for (int i = ranges.count() - 1; i >= 0; --i)
+        {
+            q->beginRemoveRows(QModelIndex(), ranges.at(i).first, ranges.at(i).last);
+            removePagedRows(ranges.at(i).first, ranges.at(i).last);
+            q->endRemoveRows();
+        }
+        return trashedRows.count();
+    }
+
+    for (const RowSelection::Range &range : trashedRows.ranges())
+    {
+        for (int row = range.first; row <= range.last; ++row)
+        {
+            int offset = 0;
+            if(RowBlock *block = blockAt(row, &offset, false))
+                block->setValue(offset, softDeleteColumn, QVariant());
+        }
+        emit q->dataChanged(q->index(range.first, softDeleteColumn),
+                            q->index(range.last, softDeleteColumn));
+    }
+
+    return trashedRows.count();
+}
+
+/**
+ * @brief tell views the check state of a range of rows changed
+ * @param first
+ * @param last
+ */
+void TableModelPrivate::announceSelection(int first, int last)
+{
+    Q_Q(TableModel);
+    if(first > last)
+        return;
+
+    emit q->dataChanged(q->index(first, 0), q->index(last, q->columnCount() - 1),
+                        { Qt::CheckStateRole });
+    emit q->selectionChanged();
+}
+
+EditQueue *TableModelPrivate::ensureEdits()
+{
+    Q_Q(TableModel);
+    if(edits)
+        return edits;
+
+    edits = new EditQueue(q);
+    edits->setInterval(flushInterval);
+    edits->setThreshold(flushThreshold);
+    QObject::connect(edits, &EditQueue::failed, q, [this](const QVector<EditQueue::Edit> &failed, const QString &error) {
+        handleEditsFailed(failed, error);
+    });
+
+    // the statements of the current query name the table and fields
+    EditQueue::Target target;
+    target.databaseName = databaseName;
+    target.table = query.table;
+    target.keyField = query.keyField;
+    target.fields = query.fields;
+    edits->setTarget(target);
+    return edits;
+}
+
+/**
+ * @brief rows with edits that were not written show the values of the
+ * table again, then each failed cell is told by editFailed()
+ * @param failed
+ * @param error
+ */
+void TableModelPrivate::handleEditsFailed(const QVector<EditQueue::Edit> &failed, const QString &error)
+{
+    Q_Q(TableModel);
+    errorString = error;
+    QSet<qint64> reloaded;
+    for (const EditQueue::Edit &edit : failed)
+    {
+        if(!reloaded.contains(edit.key))
+        {
+            reloaded.insert(edit.key);
+            reloadRow(edit.key);
+        }
+
+        bool known = true;
+        const int row = findRow(edit.key, &known);
+        emit q->editFailed(row, edit.column, edit.value, error);
+    }
+    emit q->error(error);
+}
+
+/**
+ * @brief read a fetched row from the table again
+ * @param key
+ */
+void TableModelPrivate::reloadRow(qint64 key)
+{
+    Q_Q(TableModel);
+    bool known = true;
+    if(findRow(key, &known) < 0)
+        return;
+
+    QSqlQuery sqlQuery = Sql::statement(query.rowStatement(), q->database());
+    sqlQuery.addBindValue(key);
+    if(!QueryProfiler::exec(sqlQuery, "model") || !sqlQuery.next())
+        return;
+
+    RowBlock row(layout);
+    row.append(sqlQuery);
+    sqlQuery.finish();
+    applyChange(row, true);
+}
+
+TableFetcher *TableModelPrivate::ensureFetcher()
+{
+    Q_Q(TableModel);
+    if(fetcher)
+        return fetcher;
+
+    fetcherThread = new QThread(q);
+    fetcher = new TableFetcher();
+    // the generation may have moved on before there was a fetcher to tell
+    fetcher->setGeneration(generation);
+    fetcher->moveToThread(fetcherThread);
+    QObject::connect(fetcherThread, &QThread::finished, fetcher, &QObject::deleteLater);
+
+    QObject::connect(fetcher, &TableFetcher::counted, q, [this](int gen, int total) {
+        if(gen != generation)
+            return;
+        setTotal(total, true);
+    });
+    QObject::connect(fetcher, &TableFetcher::fetched, q, [this](const TableRows &batch) {
+        handleFetched(batch);
+    });
+    QObject::connect(fetcher, &TableFetcher::failed, q, [this](int gen, const QString &message) {
+        Q_Q(TableModel);
+        if(gen != generation)
+            return;
+        errorString = message;
+        qWarning(lcTableModel) << message;
+        emit q->error(message);
+    });
+    QObject::connect(fetcher, &TableFetcher::finished, q, [this](int gen) {
+        handleFetchFinished(gen);
+    });
+
+    fetcherThread->start();
+    return fetcher;
+}
+
+/**
+ * @brief run the keyset query after the last fetched row on the fetcher thread
+ * @param stream keep reading batches until the end of the table
+ */
+void TableModelPrivate::startFetch(bool stream)
+{
+    Q_Q(TableModel);
+    TableFetchRequest request;
+    request.generation = generation;
+    request.databaseName = q->database().databaseName();
+    request.query = query;
+    request.layout = layout;
+    request.after = lastCursor;
+    request.batchSize = pageSize;
+    request.count = !totalExact;
+    request.stream = stream;
+
+    TableFetcher *worker = ensureFetcher();
+    worker->setGeneration(generation);
+    setLoading(true);
+    QMetaObject::invokeMethod(worker, [worker, request]() {
+        worker->fetch(request);
+    }, Qt::QueuedConnection);
+}
+
+void TableModelPrivate::handleFetched(const TableRows &batch)
+{
+    // rows of a cancelled or replaced select
+    if(batch.generation != generation)
+        return;
+
+    if(batch.reload)
+    {
+        fillPage(batch);
+        return;
+    }
+
+    if(batch.after != lastCursor)
+        return;
+
+    if(batch.last)
+        atEnd = true;
+
+    appendPage(batch.after, batch.rows, true);
+    if(atEnd)
+        setTotal(pagedRows, true);
+    updateProgress();
+}
+
+void TableModelPrivate::handleFetchFinished(int gen)
+{
+    if(gen != generation)
+        return;
+
+    setLoading(false);
+    updateProgress();
+}
+
+void TableModelPrivate::setLoading(bool value)
+{
+    Q_Q(TableModel);
+    if(loading == value)
+        return;
+
+    loading = value;
+    emit q->loadingChanged();
+}
+
+/**
+ * @brief a row count for the view to size itself before the rows are
+ * fetched: the rows ANALYZE found in sqlite_stat1, where the partial index
+ * of the scope holds the rows of the scope, or else the largest rowid.
+ * with a filter the estimate is an upper bound. the exact count follows
+ * from the fetcher thread.
+ */
+void TableModelPrivate::estimateTotal()
+{
+    Q_Q(TableModel);
+    QSqlDatabase db = q->database();
+    const QString scopeIndex = IndexAdvisor::indexName(q->tableName(), { "deleted_at" }, scopeClause());
+    const bool scopeOnly = filters.isEmpty() && search.simplified().isEmpty() && !scopeClause().isEmpty();
+    int tableRows = -1, scopeRows = -1;
+
+    // sqlite_stat1 exists after the first ANALYZE only, not from the statement cache
+    QSqlQuery stat(db);
+    stat.prepare("SELECT idx, CAST(stat AS INTEGER) FROM sqlite_stat1 WHERE tbl = ?");
+    stat.addBindValue(q->tableName());
+    if(stat.exec())
+    {
+        // a partial index holds fewer rows than the table
+        while (stat.next())
+        {
+            const int rows = stat.value(1).toInt();
+            tableRows = qMax(tableRows, rows);
+            if(stat.value(0).toString() == scopeIndex)
+                scopeRows = rows;
+        }
+    }
+
+    int estimate = scopeOnly && scopeRows >= 0 ? scopeRows : tableRows;
+    if(estimate < 0)
+    {
+        QSqlQuery maxRowid = Sql::statement(QString("SELECT MAX(rowid) FROM %1").arg(query.table), db);
+        if(QueryProfiler::exec(maxRowid, "model") && maxRowid.next())
+            estimate = maxRowid.value(0).toInt();
+        maxRowid.finish();
+    }
+
+    setTotal(qMax(0, estimate), false);
+}
+
+/**
+ * @brief count the rows of the query on the fetcher thread, the count
+ * replaces the estimate, see estimateTotal()
+ */
+void TableModelPrivate::requestCount()
+{
+    Q_Q(TableModel);
+    TableFetchRequest request;
+    request.generation = generation;
+    request.databaseName = q->database().databaseName();
+    request.query = query;
+    request.count = true;
+    request.countOnly = true;
+
+    TableFetcher *worker = ensureFetcher();
+    worker->setGeneration(generation);
+    QMetaObject::invokeMethod(worker, [worker, request]() {
+        worker->fetch(request);
+    }, Qt::QueuedConnection);
+}
+
+void TableModelPrivate::setTotal(int total, bool exact)
+{
+    Q_Q(TableModel);
+    if(totalRows == total && totalExact == exact)
+        return;
+
+    totalRows = total;
+    totalExact = exact;
+    emit q->totalRowsChanged();
+    updateProgress();
+}
+
+/**
+ * @brief keep the count up to date with rows the model inserted or removed
+ * @param delta
+ */
+void TableModelPrivate::adjustTotal(int delta)
+{
+    if(totalRows < 0)
+        return;
+
+    setTotal(qMax(0, totalRows + delta), totalExact);
+}
+
+void TableModelPrivate::updateProgress()
+{
+    Q_Q(TableModel);
+    qreal value = 0;
+    if(atEnd)
+        value = 1;
+    else if(totalRows > 0)
+        value = qBound<qreal>(0, qreal(pagedRows) / totalRows, 1);
+
+    if(qFuzzyCompare(progress + 1, value + 1))
+        return;
+
+    progress = value;
+    emit q->progressChanged();
+}
+
+/**
+ * @brief remember the data version and the end of the change log before
+ * a select, changes are looked up from there on. a change committed
+ * between this and the select is applied once more, which is harmless.
+ */
+void TableModelPrivate::markSync()
+{
+    Q_Q(TableModel);
+    QSqlDatabase db = q->database();
+    QSqlQuery version = Sql::statement("PRAGMA data_version", db);
+    if(version.exec() && version.next())
+        dataVersion = version.value(0).toLongLong();
+    version.finish();
+
+    syncedSeq = -1;
+    if(!changeLog)
+        return;
+
+    QSqlQuery sqlQuery = Sql::statement(QString("SELECT coalesce(max(seq), 0) FROM %1")
+                                        .arg(db.driver()->escapeIdentifier(q->tableName() + "_changes",
+                                                                           QSqlDriver::TableName)), db);
+    if(sqlQuery.exec() && sqlQuery.next())
+        syncedSeq = sqlQuery.value(0).toLongLong();
+    sqlQuery.finish();
+}
+
+/**
+ * @brief poll data_version every syncInterval
+ */
+void TableModelPrivate::startSync()
+{
+    Q_Q(TableModel);
+    if(!syncTimer)
+    {
+        syncTimer = new QTimer(q);
+        QObject::connect(syncTimer, &QTimer::timeout, q, [this]() {
+            pollChanges();
+        });
+    }
+
+    if(syncInterval > 0)
+        syncTimer->start(syncInterval);
+    else
+        syncTimer->stop();
+}
+
+/**
+ * @brief data_version changes when another connection commits to the
+ * database, which is cheap to ask for on every tick
+ */
+void TableModelPrivate::pollChanges()
+{
+    Q_Q(TableModel);
+    // a running select is synced on a later tick
+    if(!completed || loading)
+        return;
+
+    if(!relations.validate(q->database()).isEmpty() && q->rowCount() > 0)
+        emit q->dataChanged(q->index(0, 0), q->index(q->rowCount() - 1, q->columnCount() - 1));
+
+    QSqlQuery sqlQuery = Sql::statement("PRAGMA data_version", q->database());
+    if(!sqlQuery.exec() || !sqlQuery.next())
+        return;
+
+    const qint64 version = sqlQuery.value(0).toLongLong();
+    sqlQuery.finish();
+    if(version == dataVersion)
+        return;
+
+    dataVersion = version;
+    q->sync();
+}
+
+/**
+ * @brief apply the changes since the last sync to the fetched rows.
+ * the triggers of the table write each change to the <table>_changes log
+ * (see migrations/005_books_changes.sql), its seq grows in commit order,
+ * so the log is read from the last seq applied on. the filter is evaluated
+ * for each changed row, so rows can leave and join the model as well.
+ * @return false if the changes can not be placed, the caller selects again
+ */
+bool TableModelPrivate::syncChanges()
+{
+    Q_Q(TableModel);
+    QSqlDatabase db = q->database();
+    if(keyColumn == -1 || syncedSeq < 0)
+        return false;
+
+    resolveTables();
+    if(!changeLog)
+        return false;
+
+    QSqlQuery sqlQuery = Sql::statement(QString("SELECT seq, %1, deleted FROM %2 WHERE seq > ? ORDER BY seq")
+                                        .arg(escapedField(keyField),
+                                             db.driver()->escapeIdentifier(q->tableName() + "_changes",
+                                                                           QSqlDriver::TableName)), db);
+    sqlQuery.addBindValue(syncedSeq);
+    if(!QueryProfiler::exec(sqlQuery, "model"))
+    {
+        qWarning(lcTableModel) << "Read change log error" << sqlQuery.lastError().text();
+        return false;
+    }
+
+    // the last change of a key wins
+    QHash<qint64, bool> changes;
+    qint64 seq = syncedSeq;
+    while (sqlQuery.next())
+    {
+        // seq has no gaps unless the log was pruned past the cursor
+        const qint64 next = sqlQuery.value(0).toLongLong();
+        if(next != seq + 1)
+            return false;
+        seq = next;
+        changes.insert(sqlQuery.value(1).toLongLong(), sqlQuery.value(2).toBool());
+    }
+    sqlQuery.finish();
+    syncedSeq = seq;
+
+    QVector<qint64> deleted;
+    QVector<qint64> updated;
+    for (auto it = changes.cbegin(); it != changes.cend(); ++it)
+        (it.value() ? deleted : updated) << it.key();
+    std::sort(updated.begin(), updated.end());
+
+    const QString statement = QString("SELECT %1, CASE WHEN %2 THEN 1 ELSE 0 END FROM %3 WHERE %4 IN (%5) ORDER BY %4")
+            .arg(query.selectList(),
+                 query.where.isEmpty() ? QString("1") : '(' + query.where + ')',
+                 query.table, query.keyField, "%1");
+    RowBlock changed(layout);
+    QVector<bool> matched;
+    const int matchedColumn = query.fields.count();
+    // one slice for each chunk of execForKeys, read before the next
+    static const int sliceSize = 500;
+    for (int i = 0; i < updated.count(); i += sliceSize)
+    {
+        QVariantList keys;
+        const int end = qMin(i + sliceSize, updated.count());
+        keys.reserve(end - i);
+        for (int j = i; j < end; ++j)
+            keys << updated.at(j);
+
+        if(!execForKeys(sqlQuery, statement, keys, query.whereValues))
+        {
+            qWarning(lcTableModel) << "Read changed rows error" << sqlQuery.lastError().text();
+            return false;
+        }
+
+        while (sqlQuery.next())
+        {
+            changed.append(sqlQuery);
+            matched << sqlQuery.value(matchedColumn).toBool();
+        }
+        sqlQuery.finish();
+    }
+
+    for (qint64 key : deleted)
+    {
+        bool known = true;
+        const int row = findRow(key, &known);
+        if(!known)
+            return false;
+        if(row < 0)
+            continue;
+
+        q->beginRemoveRows(QModelIndex(), row, row);
+        removePagedRows(row, row);
+        q->endRemoveRows();
+    }
+
+    QVector<QVariant> values(layout.count());
+    for (int i = 0; i < changed.rowCount(); ++i)
+    {
+        for (int column = 0; column < values.count(); ++column)
+            values[column] = changed.value(i, column);
+
+        RowBlock row(layout);
+        row.append(values);
+        if(!applyChange(row, matched.at(i)))
+            return false;
+    }
+
+    // rows past the fetched ones may have joined or left, count them again
+    if(!atEnd && (!deleted.isEmpty() || !changed.isEmpty()))
+        requestCount();
+
+    qDebug(lcTableModel) << "synced" << changed.rowCount() << "changed and"
+                         << deleted.count() << "deleted rows";
+    return true;
+}
+
+/**
+ * @brief the page a row at the cursor belongs to: the last page
+ * starting before the cursor
+ * @param cursor
+ * @return -1 if the row comes after the fetched rows, fetchMore() reads it
+ */
+int TableModelPrivate::pageFor(const TableCursor &cursor) const
+{
+    if(pages.isEmpty() || (!atEnd && query.compare(cursor, lastCursor) > 0))
+        return -1;
+
+    int low = 0, high = pages.count();
+    while (low < high)
+    {
+        const int middle = (low + high) / 2;
+        if(query.compare(pages.at(middle).after, cursor) < 0)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return qMax(0, low - 1);
+}
+
+/**
+ * @brief the row of a key among the fetched rows. rows ordered by key are
+ * found in the one page the key falls into, a sorted model looks through
+ * its resident pages.
+ * @param key
+ * @param known false if the row may be in an evicted page of a sorted model
+ * @return the row, or -1
+ */
+int TableModelPrivate::findRow(qint64 key, bool *known) const
+{
+    *known = true;
+    if(!query.isSorted())
+    {
+        TableCursor cursor;
+        cursor.valid = true;
+        cursor.key = key;
+        const int index = pageFor(cursor);
+        if(index < 0 || pages.at(index).count == 0)
+            return -1;
+
+        int offset = 0;
+        const RowBlock *block = blockAt(pageOffsets.at(index), &offset);
+        if(!block)
+        {
+            *known = false;
+            return -1;
+        }
+
+        for (int i = 0; i < block->rowCount(); ++i)
+        {
+            if(block->integer(i, keyColumn) == key)
+                return pageOffsets.at(index) + i;
+        }
+        return -1;
+    }
+
+    for (int i = 0; i < pages.count(); ++i)
+    {
+        const TablePage &page = pages.at(i);
+        if(page.rows.isEmpty())
+        {
+            *known = false;
+            continue;
+        }
+
+        for (int j = 0; j < page.rows.rowCount(); ++j)
+        {
+            if(page.rows.integer(j, keyColumn) == key)
+                return pageOffsets.at(i) + j;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief update a changed row in place, or move it when its sort value
+ * changed, or drop it when it no longer matches the filter
+ * @param row the changed row
+ * @param matched whether the row matches the filter
+ * @return false if the row can not be placed
+ */
+bool TableModelPrivate::applyChange(const RowBlock &row, bool matched)
+{
+    Q_Q(TableModel);
+    bool known = true;
+    const int current = findRow(row.integer(0, keyColumn), &known);
+    if(!known)
+        return false;
+
+    // lazy columns are read again when they are shown
+    lazyRows.remove(row.integer(0, keyColumn));
+
+    if(current >= 0)
+    {
+        int offset = 0;
+        RowBlock *block = blockAt(current, &offset);
+        if(!block)
+            return false;
+
+        const bool moved = query.compare(query.cursor(*block, offset), query.cursor(row, 0)) != 0;
+        if(matched && !moved)
+        {
+            int first = -1, last = -1;
+            for (int column = 0; column < block->columnCount(); ++column)
+            {
+                const QVariant value = row.value(0, column);
+                if(block->value(offset, column) == value)
+                    continue;
+
+                block->setValue(offset, column, value);
+                if(first == -1)
+                    first = column;
+                last = column;
+            }
+
+            if(first != -1)
+                emit q->dataChanged(q->index(current, first), q->index(current, last));
+            return true;
+        }
+
+        q->beginRemoveRows(QModelIndex(), current, current);
+        removePagedRows(current, current);
+        q->endRemoveRows();
+    }
+
+    return !matched || insertChanged(row);
+}
+
+/**
+ * @brief insert a row that joined the model at its place in sort order
+ * @param row
+ * @return
+ */
+bool TableModelPrivate::insertChanged(const RowBlock &row)
+{
+    Q_Q(TableModel);
+    const TableCursor cursor = query.cursor(row, 0);
+    if(pages.isEmpty())
+    {
+        // nothing fetched yet, the first fetch reads the row
+        if(!atEnd)
+            return true;
+
+        TablePage page;
+        page.rows = RowBlock(layout);
+        pages.append(page);
+        pageOffsets.append(0);
+        ++residentPages;
+    }
+
+    const int index = pageFor(cursor);
+    if(index < 0)
+        return true;
+
+    int offset = 0;
+    if(pages.at(index).count > 0 && !blockAt(pageOffsets.at(index), &offset))
+        return false;
+
+    TablePage &page = pages[index];
+    int position = 0;
+    while (position < page.count && query.compare(query.cursor(page.rows, position), cursor) < 0)
+        ++position;
+
+    const int modelRow = pageOffsets.at(index) + position;
+    q->beginInsertRows(QModelIndex(), modelRow, modelRow);
+    page.rows.insert(position, row);
+    page.lastUsed = ++tick;
+    ++page.count;
+    updateOffsets(index + 1);
+    adjustTotal(1);
+    if(query.compare(cursor, lastCursor) > 0)
+        lastCursor = cursor;
+    evictPages(index);
+    q->endInsertRows();
+
+    return true;
+}
+
+/**
+ * @brief TableModel::TableModel
+ * @param parent
+ */
+TableModel::TableModel(QObject *parent)
+    : QSqlRelationalTableModel(parent, Sql::database())
+    , d_ptr(new TableModelPrivate())
+{
+    Q_D(TableModel);
+    d->q_ptr = this;
+
+    // keep the selected rows in place when rows come and go
+    connect(this, &QAbstractItemModel::rowsInserted, this, [d](const QModelIndex &parent, int first, int last) {
+        if(!parent.isValid())
+            d->selection.insertRows(first, last - first + 1);
+    });
+    connect(this, &QAbstractItemModel::rowsRemoved, this, [d](const QModelIndex &parent, int first, int last) {
+        if(!parent.isValid())
+            d->selection.removeRows(first, last - first + 1);
+    });
+    connect(this, &QAbstractItemModel::modelReset, this, [d]() {
+        d->selection.clear();
+    });
+
+    setEditStrategy(OnFieldChange);
+}
+
+TableModel::~TableModel()
+{
+    Q_D(TableModel);
+    if(d->edits)
+        d->edits->waitForFlushed(-1);
+
+    if(d->fetcherThread)
+    {
+        d->fetcher->setGeneration(-1);
+        d->fetcherThread->quit();
+        d->fetcherThread->wait();
+    }
+}
+
+void TableModel::classBegin()
+{
+    qDebug(lcTableModel) << "TableModel::classBegin";
+}
+
+void TableModel::componentComplete()
+{
+    Q_D(TableModel);
+    qDebug(lcTableModel) << "TableModel::componentComplete";
+    d->completed = true;
+
+    // connect signals slots
+    // ...
+
+    d->handleDatanaseChanged();
+    QSqlRelationalTableModel::setTable(d->tableName);
+
+    qDebug() << "database:" << this->database().databaseName()
+             << ", table:"  << this->tableName()
+             << ", connection name:"  << this->database().connectionName();
+
+    this->select();
+}
+
+QHash<int, QByteArray> TableModel::roleNames() const
+{
+    Q_D(const TableModel);
+    QHash<int, QByteArray> roles;
+
+    // for checked
+    roles.insert(Qt::CheckStateRole, QByteArrayLiteral("checkState"));
+
+    // database table fileds
+    QSqlRecord record = this->record();
+    for (int i = 0; i < record.count(); ++i)
+    {
+        roles.insert(Qt::UserRole + 1 + i, record.fieldName(i).toUtf8());
+    }
+
+    d->roles = roles;
+
+    return roles;
+}
+
+bool TableModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+    Q_D(TableModel);
+    if(!index.isValid())
+        return false;
+
+    if(role < Qt::UserRole)
+    {
+        if(role == Qt::CheckStateRole)
+        {
+            if(value.toBool())
+                d->selection.select(index.row(), index.row());
+            else
+                d->selection.deselect(index.row(), index.row());
+            emit selectionChanged();
+            emit dataChanged(index, index, {role});
+            return true;
+        }
+
+        if(d->keyset())
+            return role == Qt::EditRole && d->updateValue(index.row(), index.column(), value);
+
+        return QSqlRelationalTableModel::setData(index, value, role);
+    }
+
+    int column = role - Qt::UserRole - 1;
+    if(d->keyset())
+        return d->updateValue(index.row(), column, value);
+
+    QModelIndex modelIndex = createIndex(index.row(), column);
+    return QSqlRelationalTableModel::setData(modelIndex, value, Qt::EditRole);
+}
+
+QVariant TableModel::data(const QModelIndex &index, int role) const
+{
+    Q_D(const TableModel);
+    if (!index.isValid())
+        return QVariant();
+
+    QVariant value;
+    if(role < Qt::UserRole)
+    {
+        if(role == Qt::CheckStateRole)
+            return d->selection.contains(index.row());
+
+        if(d->keyset())
+        {
+            if(role == Qt::DisplayRole)
+                return d->display(index.column(), d->value(index.row(), index.column()));
+            return role == Qt::EditRole ? d->value(index.row(), index.column()) : QVariant();
+        }
+
+        if(role == Qt::DisplayRole)
+            return d->display(index.column(), QSqlRelationalTableModel::data(index, Qt::EditRole));
+
+        return QSqlRelationalTableModel::data(index, role);
+    }
+
+    // the field roles show foreign keys by their display text
+    int column = role - Qt::UserRole - 1;
+    if(d->keyset())
+        return d->display(column, d->value(index.row(), column));
+
+    QModelIndex modelIndex = createIndex(index.row(), column);
+    return d->display(column, QSqlRelationalTableModel::data(modelIndex, Qt::DisplayRole));
+}
+
+bool TableModel::removeRows(int row, int count, const QModelIndex &parent)
+{
+    Q_D(TableModel);
+    if (parent.isValid() || row < 0 || count <= 0)
+        return false;
+    else if (row + count > rowCount())
+        return false;
+    else if (!count)
+        return true;
+
+    int softDeleteColumn = fieldIndex("deleted_at");
+    bool supportSoftDelete = softDeleteColumn != -1;
+
+    // set-based path, needs the primary key of each row
+    bool bulk = editStrategy() != OnManualSubmit || d->keyset();
+    if(bulk && (d->keyset() || d->resolveKeyField()))
+    {
+        RowSelection rows;
+        rows.select(row, row + count - 1);
+        if(d->removeRowList(rows) < 0)
+        {
+            emit error(d->errorString);
+            return false;
+        }
+        return true;
+    }
+
+    bool success = false;
+    if(supportSoftDelete)
+    {
+        for (int idx = row + count - 1; idx >= row; --idx)
+        {
+            if(d->isTrashed(idx, softDeleteColumn))
+            {
+                // hard delete
+                success = QSqlRelationalTableModel::removeRows(idx, 1, parent);
+            }
+            else
+            {
+                // soft delete (just filling deleted_at field)
+                QString t = QDateTime::currentDateTime().toString(Qt::ISODate);
+                success = setData(createIndex(idx, softDeleteColumn), t, Qt::EditRole);
+            }
+
+            if(!success)
+            {
+                d->errorString =  "Something wrong happen " + this->lastError().text();
+                qWarning() << d->errorString;
+                emit error(d->errorString);
+                break;
+            }
+        }
+
+        if(success && editStrategy() == OnManualSubmit)
+            return submitAll();
+    }
+    else
+    {
+        success = QSqlRelationalTableModel::removeRows(row, count, parent);
+    }
+
+    return success;
+}
+
+int TableModel::rowCount(const QModelIndex &parent) const
+{
+    Q_D(const TableModel);
+    if(!d->keyset())
+        return QSqlRelationalTableModel::rowCount(parent);
+
+    return parent.isValid() ? 0 : d->pagedRows;
+}
+
+bool TableModel::canFetchMore(const QModelIndex &parent) const
+{
+    Q_D(const TableModel);
+    if(!d->keyset())
+        return QSqlRelationalTableModel::canFetchMore(parent);
+
+    return !parent.isValid() && !d->atEnd && !d->loading;
+}
+
+void TableModel::fetchMore(const QModelIndex &parent)
+{
+    Q_D(TableModel);
+    if(!d->keyset())
+    {
+        QSqlRelationalTableModel::fetchMore(parent);
+        return;
+    }
+
+    if(parent.isValid() || d->atEnd || d->loading)
+        return;
+
+    if(d->async)
+        d->startFetch(!d->paged);
+    else
+        d->fetchPage(true);
+}
+
+void TableModel::setDatabaseName(const QString &fileName)
+{
+    Q_D(TableModel);
+    if(!fileName.compare(d->databaseName, Qt::CaseInsensitive))
+        return;
+
+    d->databaseName = fileName;
+    if(d->completed)
+        d->handleDatanaseChanged();
+
+    emit databaseNameChanged();
+}
+
+QString TableModel::databaseName() const
+{
+    Q_D(const TableModel);
+    return d->databaseName;
+}
+
+void TableModel::setTable(const QString &tableName)
+{
+    Q_D(TableModel);
+    // remove whitespace from the start and the end
+    const QString table = tableName.trimmed();
+    if(!table.compare(this->tableName(), Qt::CaseInsensitive))
+        return;
+
+    if(this->database().isValid() && d->completed)
+    {
+        // queued edits are written to the table they were made on
+        if(d->edits)
+            d->edits->waitForFlushed();
+        this->clearSelection();
+        // relations are kept by column, of the old table
+        d->relations.clear();
+
+        if(d->keyset())
+        {
+            // the pages, the query and the layout are of the old table
+            ++d->generation;
+            if(d->fetcher)
+                d->fetcher->setGeneration(d->generation);
+            d->setLoading(false);
+            beginResetModel();
+            d->clearPages();
+            d->lazyRows.clear();
+            QSqlRelationalTableModel::setTable(table);
+            endResetModel();
+        }
+        else
+        {
+            QSqlRelationalTableModel::setTable(table);
+        }
+    }
+
+    d->tableName = table;
+    emit tableChanged();
+
+    if(d->completed && d->keyset())
+        this->refresh();
+}
+
+QString TableModel::tableName() const
+{
+    return QSqlRelationalTableModel::tableName();
+}
+
+int TableModel::selectedRows() const
+{
+    Q_D(const TableModel);
+    return d->selection.count();
+}
+
+QString TableModel::errorString() const
+{
+    Q_D(const TableModel);
+    return d->errorString.isEmpty() ? this->lastError().text() : d->errorString;
+}
+
+/**
+ * @brief fetch rows page by page on the primary key instead of selecting
+ * the whole table, only maxPages pages are kept in memory.
+ * @param paged
+ */
+void TableModel::setPaged(bool paged)
+{
+    Q_D(TableModel);
+    if(d->paged == paged)
+        return;
+
+    bool keyset = d->keyset();
+    d->paged = paged;
+    if(d->completed && keyset != d->keyset())
+    {
+        // drop the rows cached by the other mode
+        d->clearPages();
+        QSqlRelationalTableModel::setTable(d->tableName);
+        this->refresh();
+    }
+    emit pagedChanged();
+}
+
+bool TableModel::isPaged() const
+{
+    Q_D(const TableModel);
+    return d->paged;
+}
+
+/**
+ * @brief run selects on a worker thread and stream the rows in batches,
+ * a paged model fetches each page there as well.
+ * @param async
+ */
+void TableModel::setAsync(bool async)
+{
+    Q_D(TableModel);
+    if(d->async == async)
+        return;
+
+    bool keyset = d->keyset();
+    d->async = async;
+    if(d->completed && keyset != d->keyset())
+    {
+        d->clearPages();
+        QSqlRelationalTableModel::setTable(d->tableName);
+        this->refresh();
+    }
+    emit asyncChanged();
+}
+
+bool TableModel::isAsync() const
+{
+    Q_D(const TableModel);
+    return d->async;
+}
+
+bool TableModel::isLoading() const
+{
+    Q_D(const TableModel);
+    return d->loading;
+}
+
+/**
+ * @brief the rows of the query, estimated at once when a select starts and
+ * counted on the fetcher thread after it, see totalExact. inserts and
+ * deletes through the model keep it up to date. the rows fetched so far
+ * are rowCount(). -1 without paged or async.
+ * @return
+ */
+int TableModel::totalRows() const
+{
+    Q_D(const TableModel);
+    return d->keyset() ? d->totalRows : -1;
+}
+
+bool TableModel::isTotalExact() const
+{
+    Q_D(const TableModel);
+    return d->keyset() && d->totalExact;
+}
+
+qreal TableModel::progress() const
+{
+    Q_D(const TableModel);
+    return d->progress;
+}
+
+void TableModel::setPageSize(int size)
+{
+    Q_D(TableModel);
+    size = qMax(1, size);
+    if(d->pageSize == size)
+        return;
+
+    d->pageSize = size;
+    emit pageSizeChanged();
+}
+
+int TableModel::pageSize() const
+{
+    Q_D(const TableModel);
+    return d->pageSize;
+}
+
+void TableModel::setMaxPages(int pages)
+{
+    Q_D(TableModel);
+    pages = qMax(1, pages);
+    if(d->maxPages == pages)
+        return;
+
+    d->maxPages = pages;
+    d->evictPages();
+    emit maxPagesChanged();
+}
+
+int TableModel::maxPages() const
+{
+    Q_D(const TableModel);
+    return d->maxPages;
+}
+
+/**
+ * @brief the pages read ahead of the viewport, see setViewport()
+ * @param pages
+ */
+void TableModel::setPrefetchPages(int pages)
+{
+    Q_D(TableModel);
+    pages = qMax(0, pages);
+    if(d->prefetchPages == pages)
+        return;
+
+    d->prefetchPages = pages;
+    emit prefetchPagesChanged();
+}
+
+int TableModel::prefetchPages() const
+{
+    Q_D(const TableModel);
+    return d->prefetchPages;
+}
+
+/**
+ * @brief the rows the view shows and how fast it moves. a paged model reads
+ * the pages ahead in the direction of travel on the fetcher thread, before
+ * the view gets to them, and evicts the pages far behind first.
+ * @param first the first visible row
+ * @param last the last visible row
+ * @param velocity rows per second, negative upwards
+ */
+void TableModel::setViewport(int first, int last, qreal velocity)
+{
+    Q_D(TableModel);
+    if(first < 0 || last < first)
+        return;
+
+    if(!qFuzzyIsNull(velocity))
+        d->direction = velocity > 0 ? 1 : -1;
+    else if(d->viewportLast >= 0 && first != d->viewportFirst)
+        d->direction = first > d->viewportFirst ? 1 : -1;
+    d->viewportFirst = first;
+    d->viewportLast = last;
+    d->velocity = velocity;
+    if(d->completed && d->keyset())
+        d->prefetch();
+}
+
+/**
+ * @brief string fields with few distinct values, fetched rows keep
+ * one copy of each value per page for them.
+ * @param fields
+ */
+void TableModel::setInternedColumns(const QStringList &fields)
+{
+    Q_D(TableModel);
+    if(d->internedFields == fields)
+        return;
+
+    d->internedFields = fields;
+    if(d->completed && d->keyset())
+        this->refresh();
+    emit internedColumnsChanged();
+}
+
+QStringList TableModel::internedColumns() const
+{
+    Q_D(const TableModel);
+    return d->internedFields;
+}
+
+/**
+ * @brief large fields a paged or async model does not select with the
+ * rows. a lazy field of a row is read when the view shows it, together
+ * with the other lazy fields of the row, and kept for lazyCacheSize rows.
+ * the key and the sort column are never lazy.
+ * @param fields
+ */
+void TableModel::setLazyColumns(const QStringList &fields)
+{
+    Q_D(TableModel);
+    if(d->lazyFields == fields)
+        return;
+
+    d->lazyFields = fields;
+    if(d->completed && d->keyset())
+        this->refresh();
+    emit lazyColumnsChanged();
+}
+
+QStringList TableModel::lazyColumns() const
+{
+    Q_D(const TableModel);
+    return d->lazyFields;
+}
+
+bool TableModel::isLazyColumn(int column) const
+{
+    Q_D(const TableModel);
+    return d->keyset() && d->query.lazyColumns.contains(column);
+}
+
+/**
+ * @brief the number of rows whose lazy fields are kept, least recently
+ * shown rows are dropped first
+ * @param rows
+ */
+void TableModel::setLazyCacheSize(int rows)
+{
+    Q_D(TableModel);
+    rows = qMax(1, rows);
+    if(d->lazyRows.maxCost() == rows)
+        return;
+
+    d->lazyRows.setMaxCost(rows);
+    emit lazyCacheSizeChanged();
+}
+
+int TableModel::lazyCacheSize() const
+{
+    Q_D(const TableModel);
+    return d->lazyRows.maxCost();
+}
+
+/**
+ * @brief the order of the next select, paged models seek on
+ * (column, primary key) so the database sorts through an index.
+ * @param column -1 orders by the primary key
+ * @param order
+ */
+void TableModel::setSort(int column, Qt::SortOrder order)
+{
+    Q_D(TableModel);
+    column = qMax(-1, column);
+    const bool columnChanged = d->sortColumn != column;
+    const bool orderChanged = d->sortOrder != order;
+    d->sortColumn = column;
+    d->sortOrder = order;
+    QSqlRelationalTableModel::setSort(column, order);
+
+    if(columnChanged)
+        emit sortColumnChanged();
+    if(orderChanged)
+        emit sortOrderChanged();
+}
+
+void TableModel::sort(int column, Qt::SortOrder order)
+{
+    Q_D(TableModel);
+    if(qMax(-1, column) == d->sortColumn && order == d->sortOrder)
+        return;
+
+    this->setSort(column, order);
+    if(d->completed)
+        this->select();
+}
+
+void TableModel::setSortColumn(int column)
+{
+    Q_D(TableModel);
+    this->sort(column, d->sortOrder);
+}
+
+int TableModel::sortColumn() const
+{
+    Q_D(const TableModel);
+    return d->sortColumn;
+}
+
+void TableModel::setSortOrder(Qt::SortOrder order)
+{
+    Q_D(TableModel);
+    this->sort(d->sortColumn, order);
+}
+
+Qt::SortOrder TableModel::sortOrder() const
+{
+    Q_D(const TableModel);
+    return d->sortOrder;
+}
+
+/**
+ * @brief filter rows by field values, the map is compiled into
+ * a WHERE clause with bound values, see TableModelPrivate::filterClause()
+ * @param filter
+ */
+void TableModel::setFilterMap(const QVariantMap &filter)
+{
+    Q_D(TableModel);
+    if(d->filters == filter)
+        return;
+
+    d->filters = filter;
+    if(d->completed)
+        this->select();
+    emit filterChanged();
+}
+
+QVariantMap TableModel::filterMap() const
+{
+    Q_D(const TableModel);
+    return d->filters;
+}
+
+/**
+ * @brief show only rows containing every word of the text, see
+ * TableModelPrivate::searchClause(). combines with the filter and sort.
+ * @param text
+ */
+void TableModel::setSearch(const QString &text)
+{
+    Q_D(TableModel);
+    if(d->search == text)
+        return;
+
+    d->search = text;
+    if(d->completed)
+        this->select();
+    emit searchChanged();
+}
+
+QString TableModel::search() const
+{
+    Q_D(const TableModel);
+    return d->search;
+}
+
+/**
+ * @brief the rows of a soft delete table to show: the active rows,
+ * the rows in the trash or all of them. tables without deleted_at
+ * show all rows in every scope.
+ * @param scope
+ */
+void TableModel::setScope(Scope scope)
+{
+    Q_D(TableModel);
+    if(d->scope == scope)
+        return;
+
+    d->scope = scope;
+    if(d->completed)
+        this->select();
+    emit scopeChanged();
+}
+
+TableModel::Scope TableModel::scope() const
+{
+    Q_D(const TableModel);
+    return d->scope;
+}
+
+/**
+ * @brief show a foreign key column by the display field of the row it
+ * refers to. unlike QSqlRelationalTableModel, no join is added to the
+ * select: the lookup table is kept in memory, see RelationCache.
+ * keys are edited and sorted as they are.
+ * @param column
+ * @param relation
+ */
+void TableModel::setRelation(int column, const QSqlRelation &relation)
+{
+    Q_D(TableModel);
+    if(column < 0)
+        return;
+
+    if(!relation.isValid())
+    {
+        d->relations.removeRelation(column);
+        return;
+    }
+
+    RelationCache::Relation lookup;
+    lookup.table = relation.tableName();
+    lookup.keyField = relation.indexColumn();
+    for (const QString &field : relation.displayColumn().split(','))
+    {
+        if(!field.trimmed().isEmpty())
+            lookup.displayFields << field.trimmed();
+    }
+    d->relations.setRelation(column, lookup);
+
+    if(rowCount() > 0)
+        emit dataChanged(index(0, column), index(rowCount() - 1, column));
+}
+
+/**
+ * @brief setRelation() by field name, for QML
+ * @param column
+ * @param table
+ * @param keyField
+ * @param displayField one or more fields separated by commas
+ * @return false if the model has no such field
+ */
+bool TableModel::setRelation(const QString &column, const QString &table,
+                             const QString &keyField, const QString &displayField)
+{
+    const int index = this->record().indexOf(column);
+    if(index < 0)
+    {
+        qWarning(lcTableModel) << "No field" << column << "in" << this->tableName();
+        return false;
+    }
+
+    this->setRelation(index, QSqlRelation(table, keyField, displayField));
+    return true;
+}
+
+/**
+ * @brief the rows a foreign key column can refer to, for an editor
+ * @param column
+ * @return [{ value: key, text: display text }], see RelationCache::choices()
+ */
+QVariantList TableModel::relationChoices(const QString &column)
+{
+    Q_D(TableModel);
+    const int index = this->record().indexOf(column);
+    return d->relations.choices(this->database(), index);
+}
+
+/**
+ * @brief write the table to a file on a worker thread, see TableExporter.
+ * the format follows the suffix: .csv, .json/.jsonl/.ndjson or .cbor.
+ * progress is told by exportProgress(), the end by exportFinished().
+ * @param fileName a path or a file url
+ * @param filtered only the rows of the filter and search, in the sort order
+ * @return false if an export is running already
+ */
+bool TableModel::exportTo(const QString &fileName, bool filtered)
+{
+    Q_D(TableModel);
+    if(!d->exporter)
+    {
+        d->exporter = new TableExporter(this);
+        connect(d->exporter, &TableExporter::progress, this, &TableModel::exportProgress);
+        connect(d->exporter, &TableExporter::finished, this, &TableModel::exportFinished);
+    }
+
+    // the export reads the table, not the model
+    if(d->edits)
+        d->edits->waitForFlushed();
+
+    const QUrl url(fileName);
+    const QString table = this->database().driver()->escapeIdentifier(this->tableName(), QSqlDriver::TableName);
+    QString where;
+    TableExporter::Request request;
+    request.databaseName = this->database().databaseName();
+    request.fileName = url.isLocalFile() ? url.toLocalFile() : fileName;
+    if(filtered)
+        where = d->whereClause(&request.values);
+
+    request.statement = QString("SELECT * FROM %1").arg(table);
+    request.countStatement = QString("SELECT COUNT(*) FROM %1").arg(table);
+    if(!where.isEmpty())
+    {
+        request.statement += " WHERE " + where;
+        request.countStatement += " WHERE " + where;
+    }
+
+    if(filtered && d->sortColumn >= 0 && d->sortColumn < this->record().count())
+    {
+        request.statement += QString(" ORDER BY %1 %2")
+                .arg(d->escapedField(this->record().fieldName(d->sortColumn)),
+                     d->sortOrder == Qt::DescendingOrder ? "DESC" : "ASC");
+    }
+
+    return d->exporter->start(request);
+}
+
+void TableModel::cancelExport()
+{
+    Q_D(TableModel);
+    if(d->exporter)
+        d->exporter->cancel();
+}
+
+/**
+ * @brief write the queued edits now
+ * @param wait return when they are written
+ * @return false if edits are still queued after waiting
+ */
+bool TableModel::flushEdits(bool wait)
+{
+    Q_D(TableModel);
+    if(!d->edits)
+        return true;
+
+    if(wait)
+        return d->edits->waitForFlushed();
+
+    d->edits->flush();
+    return true;
+}
+
+/**
+ * @brief the rows matching a text, best first by the bm25 rank of the
+ * full-text index. fts5 ranks all matches before the LIMIT, so paging
+ * with offset costs no more than the first page.
+ * the table is searched with LIKE in key order without a full-text index.
+ * only the rows of the model are searched: its scope and filter apply.
+ * @param text
+ * @param offset
+ * @param limit
+ * @return a list of records, field name to value, with a 'rank' entry
+ */
+QVariantList TableModel::searchRanked(const QString &text, int offset, int limit)
+{
+    Q_D(TableModel);
+    QVariantList rows;
+    const QString saved = d->search;
+    d->search = text;
+    QVariantList values;
+    const QString condition = d->searchClause(&values);
+    QVariantList whereValues;
+    const QString where = d->whereClause(&whereValues);
+    const QString ftsTable = d->searchTable();
+    d->search = saved;
+    if(condition.isEmpty())
+        return rows;
+
+    // the scope and the filter of the model, without the search
+    QStringList conditions;
+    QVariantList filterValues;
+    const QString scoped = d->scopeClause();
+    if(!scoped.isEmpty())
+        conditions << scoped;
+    const QString filter = d->filterClause(&filterValues);
+    if(!filter.isEmpty())
+        conditions << filter;
+
+    QSqlDriver *driver = this->database().driver();
+    const QString table = driver->escapeIdentifier(this->tableName(), QSqlDriver::TableName);
+    const QSqlRecord rec = this->record();
+    QStringList fields;
+    for (int i = 0; i < rec.count(); ++i)
+        fields << table + '.' + d->escapedField(rec.fieldName(i));
+
+    // the MATCH subquery means the words were long enough for the index
+    // the matches are ranked in a subquery, the fields of the filter are
+    // then only those of the table and not the columns of the index
+    QString statement;
+    QVariantList bound;
+    if(!ftsTable.isEmpty() && condition.contains(" MATCH "))
+    {
+        const QString fts = driver->escapeIdentifier(ftsTable, QSqlDriver::TableName);
+        statement = QString("SELECT %1, ranked.rank FROM (SELECT rowid, rank FROM %2 WHERE %2 MATCH ?) AS ranked"
+                            " JOIN %3 ON %3.rowid = ranked.rowid%4 ORDER BY ranked.rank LIMIT ? OFFSET ?")
+                .arg(fields.join(", "), fts, table,
+                     conditions.isEmpty() ? QString() : " WHERE " + conditions.join(" AND "));
+        bound = values + filterValues;
+    }
+    else
+    {
+        statement = QString("SELECT %1, NULL FROM %2 WHERE %3 ORDER BY %2.rowid LIMIT ? OFFSET ?")
+                .arg(fields.join(", "), table, where);
+        bound = whereValues;
+    }
+
+    QSqlQuery query = Sql::statement(statement, this->database());
+    for (const QVariant &value : bound)
+        query.addBindValue(value);
+    query.addBindValue(qMax(0, limit));
+    query.addBindValue(qMax(0, offset));
+    if(!QueryProfiler::exec(query, "model"))
+    {
+        d->errorString = "Search error " + query.lastError().text();
+        qWarning(lcTableModel) << d->errorString;
+        emit error(d->errorString);
+        return rows;
+    }
+
+    while (query.next())
+    {
+        QVariantMap row;
+        for (int i = 0; i < rec.count(); ++i)
+            row.insert(rec.fieldName(i), query.value(i));
+        row.insert("rank", query.value(rec.count()));
+        rows << row;
+    }
+
+    return rows;
+}
+
+/**
+ * @brief how often to ask the database whether another connection
+ * changed it, in milliseconds. 0 turns change tracking off.
+ * @param interval
+ */
+void TableModel::setSyncInterval(int interval)
+{
+    Q_D(TableModel);
+    interval = qMax(0, interval);
+    if(d->syncInterval == interval)
+        return;
+
+    d->syncInterval = interval;
+    if(d->syncTimer)
+    {
+        if(interval > 0)
+            d->syncTimer->start(interval);
+        else
+            d->syncTimer->stop();
+    }
+    emit syncIntervalChanged();
+}
+
+int TableModel::syncInterval() const
+{
+    Q_D(const TableModel);
+    return d->syncInterval;
+}
+
+/**
+ * @brief edits of a paged or async model are queued and written on a
+ * worker thread, see EditQueue. the model shows an edit at once, a failed
+ * edit is undone and told by editFailed(). turning it off writes the
+ * queued edits.
+ * @param enabled
+ */
+void TableModel::setWriteBehind(bool enabled)
+{
+    Q_D(TableModel);
+    if(d->writeBehind == enabled)
+        return;
+
+    d->writeBehind = enabled;
+    if(!enabled && d->edits)
+        d->edits->waitForFlushed();
+    emit writeBehindChanged();
+}
+
+bool TableModel::writeBehind() const
+{
+    Q_D(const TableModel);
+    return d->writeBehind;
+}
+
+/**
+ * @brief the time edits are collected before they are written, in milliseconds
+ * @param interval
+ */
+void TableModel::setFlushInterval(int interval)
+{
+    Q_D(TableModel);
+    interval = qMax(0, interval);
+    if(d->flushInterval == interval)
+        return;
+
+    d->flushInterval = interval;
+    if(d->edits)
+        d->edits->setInterval(interval);
+    emit flushIntervalChanged();
 }
 
-QVariant TableModel::data(const QModelIndex &index, int role) const
+int TableModel::flushInterval() const
 {
     Q_D(const TableModel);
-    if (!index.isValid())
-        return QVariant();
-
-    QVariant value;
-    if(role < Qt::UserRole)
-    {
-        if(role == Qt::CheckStateRole)
-            return d->selectionModel->isSelected(index);
+    return d->flushInterval;
+}
 
-        return QSqlRelationalTableModel::data(index, role);
-    }
+/**
+ * @brief the number of queued edits that are written without waiting
+ * @param edits
+ */
+void TableModel::setFlushThreshold(int edits)
+{
+    Q_D(TableModel);
+    edits = qMax(1, edits);
+    if(d->flushThreshold == edits)
+        return;
 
-    int column = role - Qt::UserRole - 1;
-    QModelIndex modelIndex = createIndex(index.row(), column);
-    return QSqlRelationalTableModel::data(modelIndex, Qt::DisplayRole);
+    d->flushThreshold = edits;
+    if(d->edits)
+        d->edits->setThreshold(edits);
+    emit flushThresholdChanged();
 }
 
-bool TableModel::removeRows(int row, int count, const QModelIndex &parent)
+int TableModel::flushThreshold() const
 {
-     Q_D(TableModel);
-    if (parent.isValid() || row < 0 || count <= 0)
-        return false;
-    else if (row + count > rowCount())
-        return false;
-    else if (!count)
-        return true;
-
-    bool success = false;
-    int softDeleteColumn = fieldIndex("deleted_at");
-    bool supportSoftDelete = softDeleteColumn != -1;
-    if(supportSoftDelete)
-    {
-        for (int idx = row + count - 1; idx >= row; --idx)
-        {
-            QString value = data(createIndex(row, softDeleteColumn)).toString();
-            QDateTime dt = QDateTime::fromString(value, Qt::ISODate);
-            if(dt.isValid())
-            {
-                // hard delete
-                success = QSqlRelationalTableModel::removeRows(idx, 1, parent);
-            }
-            else
-            {
-                // soft delete (just filling deleted_at field)
-                QString t = QDateTime::currentDateTime().toString(Qt::ISODate);
-                success = setData(createIndex(idx, softDeleteColumn), t, Qt::EditRole);
-            }
+    Q_D(const TableModel);
+    return d->flushThreshold;
+}
 
-            if(!success)
-            {
-                d->errorString =  "Something wrong happen " + this->lastError().text();
-                qWarning() << d->errorString;
-                emit error(d->errorString);
-                break;
-            }
-        }
+/**
+ * @brief create an index for a sort or filter once it was used
+ * a few times, see IndexAdvisor
+ * @param enabled
+ */
+void TableModel::setAutoIndex(bool enabled)
+{
+    Q_D(TableModel);
+    if(d->autoIndex == enabled)
+        return;
 
-        if(success && editStrategy() == OnManualSubmit)
-            return submitAll();
-    }
-    else
-    {
-        success = QSqlRelationalTableModel::removeRows(row, count, parent);
-    }
+    d->autoIndex = enabled;
+    emit autoIndexChanged();
+}
 
-    return success;
+bool TableModel::autoIndex() const
+{
+    Q_D(const TableModel);
+    return d->autoIndex;
 }
 
-void TableModel::setDatabaseName(const QString &fileName)
+/**
+ * @brief count the changes of the lookup tables of setRelation() with
+ * triggers, see RelationCache::setTracking(). off by default, it adds a
+ * table and triggers to the database.
+ * @param enabled
+ */
+void TableModel::setTrackRelations(bool enabled)
 {
     Q_D(TableModel);
-    if(!fileName.compare(d->databaseName, Qt::CaseInsensitive))
+    if(d->relations.tracking() == enabled)
         return;
 
-    if(d->completed)
-    {
-        this->database().close();
-        this->database().setDatabaseName(fileName);
-        this->database().open();
-    }
-
-    d->databaseName = fileName;
-    emit databaseNameChanged();
+    d->relations.setTracking(enabled);
+    emit trackRelationsChanged();
 }
 
-QString TableModel::databaseName() const
+bool TableModel::trackRelations() const
 {
     Q_D(const TableModel);
-    return d->databaseName;
+    return d->relations.tracking();
 }
 
-void TableModel::setTable(const QString &tableName)
+/**
+ * @brief the pragmas set on the connections of the model when they open:
+ * "default", "readHeavy", "writeHeavy" or "inMemory", see StorageProfile.
+ * connections the fetcher opens to the database use it as well.
+ * unset, the model follows the profile set for the database in the pool.
+ * @param name
+ */
+void TableModel::setStorageProfile(const QString &name)
 {
     Q_D(TableModel);
-    // remove whitespace from the start and the end
-    const QString table = tableName.trimmed();
-    if(!table.compare(this->tableName(), Qt::CaseInsensitive))
-        return;
-
-    if(this->database().isValid() && d->completed)
+    bool ok = false;
+    const StorageProfile::Profile profile = StorageProfile::fromName(name, &ok);
+    if(!ok)
     {
-        QSqlRelationalTableModel::setTable(table);
+        qWarning(lcTableModel) << "Unknown storage profile" << name;
+        return;
     }
 
-    d->tableName = table;
-    emit tableChanged();
+    if(d->ownProfile && d->storageProfile == profile)
+        return;
+
+    d->ownProfile = true;
+    d->storageProfile = profile;
+    ConnectionPool::instance()->setStorageProfile(d->databaseName, profile);
+    if(d->completed && this->database().isOpen())
+        StorageProfile::apply(this->database(), profile);
+
+    emit storageProfileChanged();
 }
 
-QString TableModel::tableName() const
+QString TableModel::storageProfile() const
 {
-    return QSqlRelationalTableModel::tableName();
+    Q_D(const TableModel);
+    if(!d->ownProfile)
+        return StorageProfile::name(ConnectionPool::instance()->storageProfile(d->databaseName));
+    return StorageProfile::name(d->storageProfile);
 }
 
-int TableModel::selectedRows() const
+/**
+ * @brief the row writes of QSqlTableModel hold the writer lock of the
+ * database like the writes of the model, see WriterLock
+ */
+bool TableModel::insertRowIntoTable(const QSqlRecord &values)
 {
-    Q_D(const TableModel);
-    if(!d->selectionModel)
-        return 0;
+    WriterLock writer(this->database().databaseName(), WRITER_TIMEOUT);
+    if(!writer.isLocked())
+    {
+        setLastError(QSqlError(QString(), "the database is busy", QSqlError::TransactionError));
+        return false;
+    }
+    return QSqlRelationalTableModel::insertRowIntoTable(values);
+}
 
-    return d->selectionModel->selectedIndexes().count();
+bool TableModel::updateRowInTable(int row, const QSqlRecord &values)
+{
+    WriterLock writer(this->database().databaseName(), WRITER_TIMEOUT);
+    if(!writer.isLocked())
+    {
+        setLastError(QSqlError(QString(), "the database is busy", QSqlError::TransactionError));
+        return false;
+    }
+    return QSqlRelationalTableModel::updateRowInTable(row, values);
 }
 
-QString TableModel::errorString() const
+bool TableModel::deleteRowFromTable(int row)
 {
-    Q_D(const TableModel);
-    return d->errorString.isEmpty() ? this->lastError().text() : d->errorString;
+    WriterLock writer(this->database().databaseName(), WRITER_TIMEOUT);
+    if(!writer.isLocked())
+    {
+        setLastError(QSqlError(QString(), "the database is busy", QSqlError::TransactionError));
+        return false;
+    }
+    return QSqlRelationalTableModel::deleteRowFromTable(row);
 }
 
 bool TableModel::select()
 {
+    Q_D(TableModel);
+    // QSqlTableModel::setFilter() selects by itself, refresh() selects anyway
+    if(d->filtering)
+        return true;
+
     return this->refresh();
 }
 
 bool TableModel::refresh()
 {
     Q_D(TableModel);
-    if(!this->database().tables().contains(this->tableName()))
+    d->relations.validate(this->database());
+    if(d->autoIndex)
+        d->advisor.use(this->database().databaseName(), this->tableName(), d->indexColumns(), d->scopeClause());
+
+    d->resolveTables();
+    if(!d->tableExists)
     {
         QString msg = QString("Can not open table '%1' in '%2'")
                 .arg(this->tableName(), this->database().databaseName());
@@ -308,16 +3411,128 @@ bool TableModel::refresh()
         return false;
     }
 
-    bool ok = QSqlRelationalTableModel::select();
+    d->markSync();
+    if(d->async)
+    {
+        this->cancel();
+        ++d->generation;
+        if(!d->resolveKeyField())
+        {
+            qWarning(lcTableModel) << "Table" << this->tableName()
+                                   << "has no integer primary key, async select disabled";
+            d->async = false;
+            emit asyncChanged();
+            return this->refresh();
+        }
+        d->buildQuery();
+
+        beginResetModel();
+        d->clearPages();
+        d->estimateTotal();
+        endResetModel();
+        d->startFetch(!d->paged);
+        d->startSync();
+        return true;
+    }
+
+    bool ok = false;
+    if(d->paged && d->resolveKeyField())
+    {
+        // pages read ahead for the rows before are of no use now
+        ++d->generation;
+        if(d->fetcher)
+            d->fetcher->setGeneration(d->generation);
+        d->setLoading(false);
+        d->buildQuery();
+        beginResetModel();
+        d->clearPages();
+        d->estimateTotal();
+        ok = d->fetchPage(false) >= 0;
+        endResetModel();
+        if(ok && !d->totalExact)
+            d->requestCount();
+    }
+    else
+    {
+        if(d->paged)
+        {
+            qWarning(lcTableModel) << "Table" << this->tableName()
+                                   << "has no integer primary key, paging disabled";
+            d->paged = false;
+            emit pagedChanged();
+        }
+
+        d->filtering = true;
+        QSqlRelationalTableModel::setFilter(d->whereClause(nullptr));
+        d->filtering = false;
+
+        QueryProfiler *profiler = QueryProfiler::instance();
+        const qint64 start = profiler->now();
+        ok = QSqlRelationalTableModel::select();
+        if(profiler->isEnabled())
+        {
+            const QSqlQuery query = this->query();
+            profiler->record("model", query.lastQuery(), start, -1, ok, &query);
+        }
+    }
+
     if(!ok)
     {
-        QString msg = "Read record error " + this->lastError().text();
+        QString msg = "Read record error "
+                + (d->keyset() ? d->errorString : this->lastError().text());
         qWarning(lcTableModel) << msg;
         d->errorString = msg;
         emit error(msg);
+        return false;
+    }
+
+    d->startSync();
+    return true;
+}
+
+/**
+ * @brief bring the rows up to date with the table without a reset.
+ * called when another connection committed to the database, see syncInterval.
+ * a model without a change log selects again.
+ * @return
+ */
+bool TableModel::sync()
+{
+    Q_D(TableModel);
+    if(!d->completed)
+        return false;
+
+    if(d->loading)
+    {
+        // the select in progress reads the changes, or the next poll does
+        d->dataVersion = -1;
+        return true;
+    }
+
+    if(d->keyset() && d->syncChanges())
+    {
+        d->updateProgress();
+        return true;
     }
 
-    return ok;
+    return this->refresh();
+}
+
+/**
+ * @brief stop the running asynchronous select, rows already fetched are kept
+ * and the rest can be read with fetchMore()
+ */
+void TableModel::cancel()
+{
+    Q_D(TableModel);
+    if(!d->loading)
+        return;
+
+    ++d->generation;
+    if(d->fetcher)
+        d->fetcher->setGeneration(d->generation);
+    d->setLoading(false);
+    d->updateProgress();
 }
 
 int TableModel::add()
@@ -335,6 +3550,18 @@ int TableModel::insert(int row)
     rec.setValue("state", TableModel::PendingStatus);
     rec.setGenerated("state", true);
 
+    if(d->keyset())
+    {
+        bool ok = false;
+        row = d->insertRecord(rec, &ok);
+        if(!ok)
+        {
+            qDebug(lcTableModel) << d->errorString;
+            emit error(d->errorString);
+        }
+        return row;
+    }
+
     bool ok = this->insertRecord(row, rec);
     if (!ok)
     {
@@ -349,6 +3576,64 @@ int TableModel::insert(int row)
     return row;
 }
 
+/**
+ * @brief insert many rows at once, see insertRows(QVector<QSqlRecord> &)
+ * @param rows objects of field name to value, fields left out get their default
+ * @return the keys of the new rows, empty on error
+ */
+QVariantList TableModel::insertRows(const QVariantList &rows)
+{
+    const QSqlRecord rec = this->record();
+    QVector<QSqlRecord> records;
+    records.reserve(rows.count());
+    for (const QVariant &row : rows)
+    {
+        QSqlRecord record = rec;
+        for (int i = 0; i < record.count(); ++i)
+            record.setGenerated(i, false);
+
+        const QVariantMap values = row.toMap();
+        for (auto it = values.constBegin(); it != values.constEnd(); ++it)
+        {
+            if(record.indexOf(it.key()) == -1)
+            {
+                qWarning(lcTableModel) << "Insert into unknown field" << it.key() << "ignored";
+                continue;
+            }
+            record.setValue(it.key(), it.value());
+            record.setGenerated(it.key(), true);
+        }
+        records.append(record);
+    }
+
+    QVariantList keys;
+    if(!this->insertRows(records))
+        return keys;
+
+    const QSqlIndex primaryKey = this->primaryKey();
+    for (const QSqlRecord &record : records)
+        keys << (primaryKey.count() == 1 ? record.value(primaryKey.fieldName(0)) : QVariant());
+    return keys;
+}
+
+/**
+ * @brief insert records with one prepared statement in one transaction,
+ * the model announces them together. fields that are not generated get
+ * their default, the generated key is written back into each record.
+ * @param records
+ * @return false if nothing was inserted
+ */
+bool TableModel::insertRows(QVector<QSqlRecord> &records)
+{
+    Q_D(TableModel);
+    if(!d->insertRecords(records))
+    {
+        emit error(d->errorString);
+        return false;
+    }
+    return true;
+}
+
 bool TableModel::remove(int row)
 {
 //    Q_D(TableModel);
@@ -363,32 +3648,50 @@ bool TableModel::remove(int row)
 int TableModel::removeSelected()
 {
     Q_D(TableModel);
+    const RowSelection rows = d->selection;
     int total = 0;
-
-    QModelIndexList list = d->selectionModel->selectedIndexes();
-    typedef QList<QModelIndex>::iterator ModelIterator;
-    ModelIterator begin = list.begin();
-    ModelIterator end = list.end();
-    std::sort(begin, end);
-
-    while (!list.isEmpty())
+    if(!d->keyset() && !d->resolveKeyField())
     {
-        QModelIndex last = list.takeLast();
-        int currentRow = last.row();
-
-        if(removeRow(currentRow))
+        // no key to address the rows with, one by one from the bottom
+        const QVector<RowSelection::Range> ranges = rows.ranges();
+        for (int i = ranges.count() - 1; i >= 0; --i)
         {
-            d->selectionModel->select(last, QItemSelectionModel::Deselect);
-            ++total;
+            for (int row = ranges.at(i).last; row >= ranges.at(i).first; --row)
+            {
+                if(removeRow(row))
+                    ++total;
+            }
         }
     }
+    else
+    {
+        total = d->removeRowList(rows);
+    }
+
+    if(total < 0)
+    {
+        emit error(d->errorString);
+        return 0;
+    }
 
+    this->clearSelection();
     return total;
 }
 
 bool TableModel::recoverRow(int row)
 {
     Q_D(TableModel);
+    // by key like recoverSelected(), so the row leaves the trash scope
+    if(d->keyset() || d->resolveKeyField())
+    {
+        RowSelection rows;
+        rows.select(row, row);
+        const int recovered = d->recoverRowList(rows);
+        if(recovered < 0)
+            emit error(d->errorString);
+        return recovered > 0;
+    }
+
     QModelIndex modelIndex = createIndex(row, 0);
     int role = d->roles.key("deleted_at");
     return this->setData(modelIndex, QVariant(), role);
@@ -397,23 +3700,79 @@ bool TableModel::recoverRow(int row)
 int TableModel::recoverSelected()
 {
     Q_D(TableModel);
+    const RowSelection rows = d->selection;
     int total = 0;
-
-    QModelIndexList list = d->selectionModel->selectedIndexes();
-    typedef QList<QModelIndex>::iterator ModelIterator;
-    ModelIterator begin = list.begin();
-    ModelIterator end = list.end();
-    std::sort(begin, end);
-
-    while (!list.isEmpty())
+    if(!d->keyset() && !d->resolveKeyField())
     {
-        QModelIndex last = list.takeLast();
-        if(this->recoverRow(last.row()))
+        for (int row : rows)
         {
-            d->selectionModel->select(last, QItemSelectionModel::Deselect);
-            ++total;
+            if(recoverRow(row))
+                ++total;
         }
     }
+    else
+    {
+        total = d->recoverRowList(rows);
+    }
 
+    if(total < 0)
+    {
+        emit error(d->errorString);
+        return 0;
+    }
+
+    this->clearSelection();
     return total;
 }
+
+bool TableModel::isSelected(int row) const
+{
+    Q_D(const TableModel);
+    return d->selection.contains(row);
+}
+
+/**
+ * @brief select or deselect the rows from first to last
+ * @param first
+ * @param last
+ * @param selected
+ */
+void TableModel::selectRange(int first, int last, bool selected)
+{
+    Q_D(TableModel);
+    first = qMax(0, first);
+    last = qMin(last, rowCount() - 1);
+    if(first > last)
+        return;
+
+    if(selected)
+        d->selection.select(first, last);
+    else
+        d->selection.deselect(first, last);
+    d->announceSelection(first, last);
+}
+
+void TableModel::selectAll()
+{
+    Q_D(TableModel);
+    d->selection.selectAll(rowCount());
+    d->announceSelection(0, rowCount() - 1);
+}
+
+void TableModel::invertSelection()
+{
+    Q_D(TableModel);
+    d->selection.invert(rowCount());
+    d->announceSelection(0, rowCount() - 1);
+}
+
+void TableModel::clearSelection()
+{
+    Q_D(TableModel);
+    if(d->selection.isEmpty())
+        return;
+
+    const QVector<RowSelection::Range> ranges = d->selection.ranges();
+    d->selection.clear();
+    d->announceSelection(ranges.first().first, ranges.last().last);
+}
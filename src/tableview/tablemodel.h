@@ -38,7 +38,31 @@ class TableModel : public QSqlRelationalTableModel,  public QQmlParserStatus
     Q_PROPERTY(QString table READ tableName WRITE setTable NOTIFY tableChanged)
     Q_PROPERTY(int selectedRows READ selectedRows NOTIFY selectionChanged)
     Q_PROPERTY(QString errorString READ errorString)
-    Q_ENUMS(ItemStatus)
+    Q_PROPERTY(bool paged READ isPaged WRITE setPaged NOTIFY pagedChanged)
+    Q_PROPERTY(int pageSize READ pageSize WRITE setPageSize NOTIFY pageSizeChanged)
+    Q_PROPERTY(int maxPages READ maxPages WRITE setMaxPages NOTIFY maxPagesChanged)
+    Q_PROPERTY(int prefetchPages READ prefetchPages WRITE setPrefetchPages NOTIFY prefetchPagesChanged)
+    Q_PROPERTY(bool async READ isAsync WRITE setAsync NOTIFY asyncChanged)
+    Q_PROPERTY(QStringList internedColumns READ internedColumns WRITE setInternedColumns NOTIFY internedColumnsChanged)
+    Q_PROPERTY(QStringList lazyColumns READ lazyColumns WRITE setLazyColumns NOTIFY lazyColumnsChanged)
+    Q_PROPERTY(int lazyCacheSize READ lazyCacheSize WRITE setLazyCacheSize NOTIFY lazyCacheSizeChanged)
+    Q_PROPERTY(int sortColumn READ sortColumn WRITE setSortColumn NOTIFY sortColumnChanged)
+    Q_PROPERTY(Qt::SortOrder sortOrder READ sortOrder WRITE setSortOrder NOTIFY sortOrderChanged)
+    Q_PROPERTY(QVariantMap filter READ filterMap WRITE setFilterMap NOTIFY filterChanged)
+    Q_PROPERTY(QString search READ search WRITE setSearch NOTIFY searchChanged)
+    Q_PROPERTY(Scope scope READ scope WRITE setScope NOTIFY scopeChanged)
+    Q_PROPERTY(bool autoIndex READ autoIndex WRITE setAutoIndex NOTIFY autoIndexChanged)
+    Q_PROPERTY(bool trackRelations READ trackRelations WRITE setTrackRelations NOTIFY trackRelationsChanged)
+    Q_PROPERTY(int syncInterval READ syncInterval WRITE setSyncInterval NOTIFY syncIntervalChanged)
+    Q_PROPERTY(bool writeBehind READ writeBehind WRITE setWriteBehind NOTIFY writeBehindChanged)
+    Q_PROPERTY(int flushInterval READ flushInterval WRITE setFlushInterval NOTIFY flushIntervalChanged)
+    Q_PROPERTY(int flushThreshold READ flushThreshold WRITE setFlushThreshold NOTIFY flushThresholdChanged)
+    Q_PROPERTY(QString storageProfile READ storageProfile WRITE setStorageProfile NOTIFY storageProfileChanged)
+    Q_PROPERTY(bool loading READ isLoading NOTIFY loadingChanged)
+    Q_PROPERTY(qreal progress READ progress NOTIFY progressChanged)
+    Q_PROPERTY(int totalRows READ totalRows NOTIFY totalRowsChanged)
+    Q_PROPERTY(bool totalExact READ isTotalExact NOTIFY totalRowsChanged)
+    Q_ENUMS(ItemStatus Scope)
 public:
     enum ItemStatus {
         SavedStatus = 0,
@@ -49,6 +73,12 @@ public:
         DeletedStatus
     };
 
+    enum Scope {
+        AllScope = 0,
+        ActiveScope,        // deleted_at IS NULL
+        TrashedScope        // deleted_at IS NOT NULL
+    };
+
     explicit TableModel(QObject *parent = nullptr);
     ~TableModel() override;
 
@@ -59,6 +89,17 @@ public:
     bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override;
     QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
     bool removeRows(int row, int count, const QModelIndex &parent = QModelIndex()) override;
+    using QSqlRelationalTableModel::insertRows;
+    bool insertRows(QVector<QSqlRecord> &records);
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    Q_INVOKABLE bool canFetchMore(const QModelIndex &parent = QModelIndex()) const override;
+    Q_INVOKABLE void fetchMore(const QModelIndex &parent = QModelIndex()) override;
+    void setSort(int column, Qt::SortOrder order) override;
+    void setRelation(int column, const QSqlRelation &relation) override;
+    Q_INVOKABLE bool setRelation(const QString &column, const QString &table,
+                                 const QString &keyField, const QString &displayField);
+    Q_INVOKABLE QVariantList relationChoices(const QString &column);
+    Q_INVOKABLE void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
 
     void setDatabaseName(const QString &fileName);
     QString databaseName() const;
@@ -70,22 +111,132 @@ public:
 
     QString errorString() const;
 
+    void setPaged(bool paged);
+    bool isPaged() const;
+
+    void setPageSize(int size);
+    int pageSize() const;
+
+    void setMaxPages(int pages);
+    int maxPages() const;
+
+    void setPrefetchPages(int pages);
+    int prefetchPages() const;
+    Q_INVOKABLE void setViewport(int first, int last, qreal velocity = 0);
+
+    void setInternedColumns(const QStringList &fields);
+    QStringList internedColumns() const;
+
+    void setLazyColumns(const QStringList &fields);
+    QStringList lazyColumns() const;
+    Q_INVOKABLE bool isLazyColumn(int column) const;
+
+    void setLazyCacheSize(int rows);
+    int lazyCacheSize() const;
+
+    void setSortColumn(int column);
+    int sortColumn() const;
+
+    void setSortOrder(Qt::SortOrder order);
+    Qt::SortOrder sortOrder() const;
+
+    void setFilterMap(const QVariantMap &filter);
+    QVariantMap filterMap() const;
+
+    void setSearch(const QString &text);
+    QString search() const;
+
+    void setScope(Scope scope);
+    Scope scope() const;
+
+    void setAutoIndex(bool enabled);
+    bool autoIndex() const;
+
+    void setTrackRelations(bool enabled);
+    bool trackRelations() const;
+
+    void setSyncInterval(int interval);
+    int syncInterval() const;
+
+    void setWriteBehind(bool enabled);
+    bool writeBehind() const;
+
+    void setFlushInterval(int interval);
+    int flushInterval() const;
+
+    void setFlushThreshold(int edits);
+    int flushThreshold() const;
+
+    void setStorageProfile(const QString &name);
+    QString storageProfile() const;
+
+    void setAsync(bool async);
+    bool isAsync() const;
+    bool isLoading() const;
+    qreal progress() const;
+    int totalRows() const;
+    bool isTotalExact() const;
+
 signals:
     void databaseNameChanged();
     void tableChanged();
+    void pagedChanged();
+    void pageSizeChanged();
+    void maxPagesChanged();
+    void prefetchPagesChanged();
+    void asyncChanged();
+    void internedColumnsChanged();
+    void lazyColumnsChanged();
+    void lazyCacheSizeChanged();
+    void sortColumnChanged();
+    void sortOrderChanged();
+    void filterChanged();
+    void searchChanged();
+    void scopeChanged();
+    void autoIndexChanged();
+    void trackRelationsChanged();
+    void syncIntervalChanged();
+    void writeBehindChanged();
+    void flushIntervalChanged();
+    void flushThresholdChanged();
+    void storageProfileChanged();
+    void loadingChanged();
+    void progressChanged();
+    void totalRowsChanged();
     void selectionChanged();
     void error(const QString &message);
+    void exportProgress(qint64 rows, qint64 total);
+    void exportFinished(bool ok, qint64 rows, const QString &error);
+    void editFailed(int row, int column, const QVariant &value, const QString &error);
 
 public slots:
     bool select() override;
     virtual bool refresh();
+    bool sync();
+    void cancel();
+    QVariantList searchRanked(const QString &text, int offset = 0, int limit = 50);
+    bool exportTo(const QString &fileName, bool filtered = true);
+    void cancelExport();
+    bool flushEdits(bool wait = false);
 
     int add();
     int insert(int row);
+    QVariantList insertRows(const QVariantList &rows);
     bool remove(int row);
     int removeSelected();
     bool recoverRow(int row);
     int recoverSelected();
+
+    bool isSelected(int row) const;
+    void selectRange(int first, int last, bool selected = true);
+    void selectAll();
+    void invertSelection();
+    void clearSelection();
+
+protected:
+    bool insertRowIntoTable(const QSqlRecord &values) override;
+    bool updateRowInTable(int row, const QSqlRecord &values) override;
+    bool deleteRowFromTable(int row) override;
 };
 
 #endif // TABLEMODEL_H
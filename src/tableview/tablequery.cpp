@@ -0,0 +1,192 @@
+/**
+ * QML examples - Qt5 and QML examples
+ * Copyright (c) 2019 Yuri Young<yuri.young@qq.com>
+ *
+ * This examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tablequery.h"
+#include "rowblock.h"
+
+bool TableCursor::operator==(const TableCursor &other) const
+{
+    if(valid != other.valid)
+        return false;
+
+    return !valid || (key == other.key && value == other.value);
+}
+
+/**
+ * @brief rows after a cursor in sort order.
+ * the seek condition compares (sort value, key) pairs, which an index on
+ * (sort field, key) answers without reading the rows before the page.
+ * sqlite sorts NULL first, so NULL sort values need a condition of their own.
+ * @param after
+ * @return
+ */
+QString TableQuery::pageStatement(const TableCursor &after) const
+{
+    const bool descending = order == Qt::DescendingOrder;
+    const QString direction = descending ? "DESC" : "ASC";
+    QStringList conditions;
+    if(!where.isEmpty())
+        conditions << QString("(%1)").arg(where);
+
+    if(after.valid)
+    {
+        if(!isSorted())
+        {
+            conditions << QString("%1 %2 ?").arg(keyField, descending ? "<" : ">");
+        }
+        else if(after.value.isNull())
+        {
+            conditions << (descending
+                           ? QString("(%1 IS NULL AND %2 < ?)").arg(sortField, keyField)
+                           : QString("((%1 IS NULL AND %2 > ?) OR %1 IS NOT NULL)").arg(sortField, keyField));
+        }
+        else
+        {
+            conditions << (descending
+                           ? QString("((%1, %2) < (?, ?) OR %1 IS NULL)").arg(sortField, keyField)
+                           : QString("(%1, %2) > (?, ?)").arg(sortField, keyField));
+        }
+    }
+
+    QString statement = QString("SELECT %1 FROM %2").arg(selectList(), table);
+    if(!conditions.isEmpty())
+        statement += " WHERE " + conditions.join(" AND ");
+
+    if(isSorted())
+        statement += QString(" ORDER BY %1 %3, %2 %3").arg(sortField, keyField, direction);
+    else
+        statement += QString(" ORDER BY %1 %2").arg(keyField, direction);
+
+    return statement + " LIMIT ?";
+}
+
+QVariantList TableQuery::pageValues(const TableCursor &after, int limit) const
+{
+    QVariantList values = whereValues;
+    if(after.valid)
+    {
+        if(isSorted() && !after.value.isNull())
+            values << after.value;
+        values << after.key;
+    }
+    values << limit;
+    return values;
+}
+
+QString TableQuery::countStatement() const
+{
+    QString statement = QString("SELECT COUNT(*) FROM %1").arg(table);
+    if(!where.isEmpty())
+        statement += " WHERE " + where;
+    return statement;
+}
+
+/**
+ * @brief one row by its key, the statement takes the key only
+ * @return
+ */
+QString TableQuery::rowStatement() const
+{
+    return QString("SELECT %1 FROM %2 WHERE %3 = ?").arg(selectList(), table, keyField);
+}
+
+/**
+ * @brief the fields of a row, lazy columns are NULL so the columns of
+ * the result stay the columns of the table
+ * @return
+ */
+QString TableQuery::selectList() const
+{
+    if(lazyColumns.isEmpty())
+        return fields.join(", ");
+
+    QStringList list = fields;
+    for (int column : lazyColumns)
+        list[column] = "NULL";
+    return list.join(", ");
+}
+
+TableCursor TableQuery::cursor(const RowBlock &rows, int row) const
+{
+    TableCursor cursor;
+    if(row < 0 || row >= rows.rowCount())
+        return cursor;
+
+    cursor.valid = true;
+    cursor.key = rows.integer(row, keyColumn);
+    if(isSorted() && !rows.isNull(row, sortColumn))
+        cursor.value = rows.value(row, sortColumn);
+    return cursor;
+}
+
+/**
+ * @brief the order of two cursors in the rows of the query,
+ * following the rules of sqlite: NULL before numbers before text
+ * @param a
+ * @param b
+ * @return negative if a comes first, 0 if equal, positive otherwise
+ */
+int TableQuery::compare(const TableCursor &a, const TableCursor &b) const
+{
+    // an invalid cursor is the position before the first row
+    if(!a.valid || !b.valid)
+        return int(a.valid) - int(b.valid);
+
+    auto numeric = [](const QVariant &value) {
+        switch (value.userType())
+        {
+        case QMetaType::Int:
+        case QMetaType::UInt:
+        case QMetaType::LongLong:
+        case QMetaType::ULongLong:
+        case QMetaType::Double:
+        case QMetaType::Bool:
+            return true;
+        default:
+            return false;
+        }
+    };
+
+    int result = 0;
+    if(isSorted())
+    {
+        const bool aNull = a.value.isNull(), bNull = b.value.isNull();
+        const bool aNumber = numeric(a.value), bNumber = numeric(b.value);
+        if(aNull || bNull)
+            result = aNull == bNull ? 0 : (aNull ? -1 : 1);
+        else if(aNumber && bNumber)
+        {
+            const double x = a.value.toDouble(), y = b.value.toDouble();
+            result = x < y ? -1 : (y < x ? 1 : 0);
+        }
+        else if(aNumber != bNumber)
+            result = aNumber ? -1 : 1;
+        else
+            result = a.value.toString().compare(b.value.toString());
+    }
+
+    if(result == 0)
+        result = a.key < b.key ? -1 : (b.key < a.key ? 1 : 0);
+
+    return order == Qt::DescendingOrder ? -result : result;
+}
+
+bool TableQuery::isSorted() const
+{
+    return !sortField.isEmpty();
+}
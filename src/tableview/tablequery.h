@@ -0,0 +1,71 @@
+/**
+ * QML examples - Qt5 and QML examples
+ * Copyright (c) 2019 Yuri Young<yuri.young@qq.com>
+ *
+ * This examples is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This examples is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TABLEQUERY_H
+#define TABLEQUERY_H
+
+#include <QStringList>
+#include <QVariant>
+#include <QSet>
+
+class RowBlock;
+
+/**
+ * @brief the position after the last row of a page:
+ * the value of the sort field and the key of that row.
+ */
+struct TableCursor
+{
+    bool valid = false;     // false: before the first row
+    QVariant value;
+    qint64 key = 0;
+
+    bool operator==(const TableCursor &other) const;
+    bool operator!=(const TableCursor &other) const { return !(*this == other); }
+};
+
+/**
+ * @brief the keyset statements of a table model.
+ * identifiers are escaped by the model, values are always bound, so the
+ * query can be copied to and used from another thread.
+ */
+class TableQuery
+{
+public:
+    QString pageStatement(const TableCursor &after) const;
+    QVariantList pageValues(const TableCursor &after, int limit) const;
+    QString countStatement() const;
+    QString rowStatement() const;
+    QString selectList() const;
+    TableCursor cursor(const RowBlock &rows, int row) const;
+    int compare(const TableCursor &a, const TableCursor &b) const;
+    bool isSorted() const;
+
+    QString table;
+    QStringList fields;
+    QString keyField;
+    int keyColumn = -1;
+    QString sortField;      // empty: ordered by the key
+    int sortColumn = -1;
+    Qt::SortOrder order = Qt::AscendingOrder;
+    QString where;          // filter condition without WHERE
+    QVariantList whereValues;
+    QSet<int> lazyColumns;  // read as NULL, the model fetches them per row
+};
+
+#endif // TABLEQUERY_H
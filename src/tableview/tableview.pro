@@ -14,13 +14,59 @@ DEFINES += QT_DEPRECATED_WARNINGS
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+        benchmark.cpp \
+        connectionpool.cpp \
+        editqueue.cpp \
+        importer.cpp \
+        indexadvisor.cpp \
         main.cpp \
         migration.cpp \
-        tablemodel.cpp
+        migrationbundle.cpp \
+        parallelmigration.cpp \
+        queryprofiler.cpp \
+        relationcache.cpp \
+        rowblock.cpp \
+        rowselection.cpp \
+        sqlstatementreader.cpp \
+        statementcache.cpp \
+        storageprofile.cpp \
+        tableexporter.cpp \
+        tablefetcher.cpp \
+        tablemodel.cpp \
+        tablequery.cpp
 
 RESOURCES += qml.qrc \
     res.qrc
 
+# precompile the migrations into :/migrations.bundle, see tools/migration_bundle.py
+isEmpty(PYTHON): PYTHON = python3
+MIGRATIONS = \
+    $$PWD/migrations/001_books.sql \
+    $$PWD/migrations/003_books_fts.sql \
+    $$PWD/migrations/004_books_deleted.sql \
+    $$PWD/migrations/005_books_changes.sql
+MIGRATION_BUNDLE = $$OUT_PWD/migrations.bundle
+MIGRATION_BUNDLE_COMMAND = $$PYTHON $$shell_path($$PWD/tools/migration_bundle.py) \
+    -o $$shell_path($$MIGRATION_BUNDLE) -q $$shell_path($$OUT_PWD/migrations_bundle.qrc) \
+    $$shell_path($$MIGRATIONS)
+
+# the resource file has to exist when qmake runs. without python the
+# application splits the scripts in :/migrations when it starts
+system($$MIGRATION_BUNDLE_COMMAND) {
+    migration_bundle.target = $$MIGRATION_BUNDLE
+    migration_bundle.depends = $$MIGRATIONS $$PWD/tools/migration_bundle.py
+    migration_bundle.commands = $$MIGRATION_BUNDLE_COMMAND
+    PRE_TARGETDEPS += $$MIGRATION_BUNDLE
+    RESOURCES += $$OUT_PWD/migrations_bundle.qrc
+
+    # make check_bundle: the bundle splits the scripts like SqlStatementReader
+    check_bundle.commands = $$shell_path($$OUT_PWD/$(TARGET)) -platform offscreen --check-bundle
+    check_bundle.depends = $(TARGET)
+    QMAKE_EXTRA_TARGETS += migration_bundle check_bundle
+} else {
+    warning("Can not build the migration bundle with $$PYTHON, the scripts are split at startup")
+}
+
 # Additional import path used to resolve QML modules in Qt Creator's code model
 QML_IMPORT_PATH =
 
@@ -33,6 +79,23 @@ else: unix:!android: target.path = /opt/$${TARGET}/bin
 !isEmpty(target.path): INSTALLS += target
 
 HEADERS += \
+    benchmark.h \
+    connectionpool.h \
+    editqueue.h \
+    importer.h \
+    indexadvisor.h \
     migration.h \
+    migrationbundle.h \
+    parallelmigration.h \
+    queryprofiler.h \
+    relationcache.h \
+    rowblock.h \
+    rowselection.h \
     sql.h \
-    tablemodel.h
+    sqlstatementreader.h \
+    statementcache.h \
+    storageprofile.h \
+    tableexporter.h \
+    tablefetcher.h \
+    tablemodel.h \
+    tablequery.h
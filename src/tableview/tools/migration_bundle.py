@@ -0,0 +1,197 @@
+#!/usr/bin/env python3
+#
+# QML examples - Qt5 and QML examples
+# Copyright (c) 2019 Yuri Young<yuri.young@qq.com>
+#
+# This examples is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Lesser General Public License as published
+# by the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This examples is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+# GNU Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this library. If not, see <http://www.gnu.org/licenses/>.
+
+"""Precompile migration scripts into a bundle read by MigrationBundle.
+
+The bundle is written in QDataStream format (big endian):
+
+    quint32 magic 'MIGB', quint32 format 1, quint32 schema version,
+    quint32 count, then per migration:
+        QString name, QByteArray sha256 of the script,
+        quint32 count, QString statement...
+
+The schema version is the highest number prefix of the migration names.
+Statements are split like SqlStatementReader does: quotes, comments and
+trigger bodies are understood, comments are dropped.
+
+usage: migration_bundle.py -o migrations.bundle [-q migrations_bundle.qrc] file.sql...
+"""
+
+import argparse
+import hashlib
+import os
+import struct
+import sys
+
+MAGIC = 0x4D494742
+FORMAT = 1
+
+
+def is_word(c):
+    return c.isalnum() or c in '_$'
+
+
+def split_statements(text):
+    statements = []
+    i, n = 0, len(text)
+
+    def at(k):
+        return text[k] if k < n else ''
+
+    while True:
+        statement, word, head = [], [], []
+        trigger, depth, state, quote = False, 0, 'normal', None
+
+        def end_word():
+            nonlocal trigger, depth
+            if not word:
+                return
+            w = ''.join(word).upper()
+            word.clear()
+            if len(head) < 3:
+                head.append(w)
+                if head[0] == 'CREATE':
+                    trigger = trigger or (len(head) == 2 and w == 'TRIGGER') \
+                        or (len(head) == 3 and w == 'TRIGGER' and head[1] in ('TEMP', 'TEMPORARY'))
+                return
+            if not trigger:
+                return
+            if w == 'BEGIN' and depth == 0:
+                depth += 1
+            elif w == 'CASE' and depth > 0:
+                depth += 1
+            elif w == 'END' and depth > 0:
+                depth -= 1
+
+        done = False
+        while i < n:
+            c, length, keep = text[i], 1, True
+            if state == 'normal':
+                if is_word(c):
+                    word.append(c)
+                else:
+                    end_word()
+                    if c in '\'"`':
+                        state, quote = 'quoted', c
+                    elif c == '[':
+                        state, quote = 'quoted', ']'
+                    elif c == '-' and at(i + 1) == '-':
+                        state, keep, length = 'line', False, 2
+                    elif c == '/' and at(i + 1) == '*':
+                        state, keep, length = 'block', False, 2
+                    elif c == ';' and depth == 0:
+                        i += 1
+                        text_ = ''.join(statement).strip()
+                        if text_:
+                            statements.append(text_)
+                            done = True
+                            break
+                        head.clear()
+                        trigger = False
+                        continue
+            elif state == 'quoted':
+                if c == quote:
+                    if quote != ']' and at(i + 1) == quote:
+                        length = 2
+                    else:
+                        state = 'normal'
+            elif state == 'line':
+                keep = c == '\n'
+                if keep:
+                    state = 'normal'
+            else:
+                keep = False
+                if c == '*' and at(i + 1) == '/':
+                    length, state = 2, 'normal'
+                    statement.append(' ')
+            if keep:
+                statement.append(text[i:i + length])
+            i += length
+
+        if done:
+            continue
+
+        end_word()
+        last = ''.join(statement).strip()
+        if last:
+            statements.append(last)
+        return statements
+
+
+def qstring(value):
+    data = value.encode('utf-16-be')
+    return struct.pack('>I', len(data)) + data
+
+
+def qbytearray(value):
+    return struct.pack('>I', len(value)) + value
+
+
+def write_if_changed(path, data):
+    # an unchanged file keeps its time, so rcc does not run again
+    try:
+        with open(path, 'rb') as f:
+            if f.read() == data:
+                return
+    except OSError:
+        pass
+    with open(path, 'wb') as f:
+        f.write(data)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Precompile migration scripts into a bundle.')
+    parser.add_argument('-o', '--output', required=True, help='bundle file to write')
+    parser.add_argument('-q', '--qrc', help='resource file to write for the bundle')
+    parser.add_argument('files', nargs='+', help='migration scripts')
+    args = parser.parse_args()
+
+    migrations = []
+    version = 0
+    for path in sorted(args.files, key=os.path.basename):
+        name = os.path.basename(path).split('.')[0]
+        with open(path, 'rb') as f:
+            data = f.read()
+        prefix = name.split('_')[0]
+        if prefix.isdigit():
+            version = max(version, int(prefix))
+        statements = split_statements(data.decode('utf-8-sig'))
+        migrations.append((name, hashlib.sha256(data).digest(), statements))
+
+    out = bytearray(struct.pack('>IIII', MAGIC, FORMAT, version, len(migrations)))
+    for name, digest, statements in migrations:
+        out += qstring(name) + qbytearray(digest) + struct.pack('>I', len(statements))
+        for statement in statements:
+            out += qstring(statement)
+
+    write_if_changed(args.output, bytes(out))
+
+    if args.qrc:
+        qrc = ('<RCC>\n'
+               '    <qresource prefix="/">\n'
+               '        <file alias="migrations.bundle">%s</file>\n'
+               '    </qresource>\n'
+               '</RCC>\n') % os.path.relpath(args.output, os.path.dirname(os.path.abspath(args.qrc)))
+        write_if_changed(args.qrc, qrc.encode('utf-8'))
+
+    print('%s: %d migrations, schema version %d' % (args.output, len(migrations), version))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())